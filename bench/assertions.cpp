@@ -0,0 +1,74 @@
+/*
+ * Per-assertion cost of BasicContext configurations. Every
+ * configuration runs the same passing and TODO assertions into
+ * a stream which discards its output.
+ */
+
+#include <tappp.hpp>
+#include <iostream>
+#include <iomanip>
+#include <streambuf>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+using namespace TAP;
+
+/* A stream buffer which throws its contents away when full */
+class Discard : public std::streambuf {
+	char buf[1 << 16];
+
+public:
+	Discard(void) {
+		setp(buf, buf + sizeof(buf));
+	}
+
+protected:
+	int overflow(int c) override {
+		setp(buf, buf + sizeof(buf));
+		return traits_type::not_eof(c);
+	}
+
+	int sync(void) override {
+		setp(buf, buf + sizeof(buf));
+		return 0;
+	}
+};
+
+template<typename Ctx>
+static void measure(const char* name, unsigned int n) {
+	Discard buf;
+	std::ostream out(&buf);
+	using clock = std::chrono::steady_clock;
+
+	auto start = clock::now();
+	{
+		Ctx ctx(out);
+		for (unsigned int i = 0; i < n; ++i) {
+			if (i % 16 == 0)
+				ctx.TODO("later");
+			ctx.ok(i % 64 != 0, "assertion");
+		}
+	}
+	auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / n;
+	std::cout << std::left << std::setw(44) << name
+	          << std::right << std::fixed << std::setprecision(1) << std::setw(8)
+	          << ns << " ns/assertion" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	unsigned int n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+	using namespace Policy;
+
+	measure<Context>("Context (Unbuffered, Threaded, Full)", n);
+	measure<BasicContext<Buffered,   Threaded,       Full>>("Buffered, Threaded, Full", n);
+	measure<BasicContext<Unbuffered, SingleThreaded, Full>>("Unbuffered, SingleThreaded, Full", n);
+	measure<BasicContext<Buffered,   SingleThreaded, Full>>("Buffered, SingleThreaded, Full", n);
+	measure<BasicContext<Buffered,   SingleThreaded, TapOnly>>("Buffered, SingleThreaded, TapOnly", n);
+	measure<BasicContext<Quiet,      Threaded,       Full>>("Quiet, Threaded, Full", n);
+	measure<BasicContext<Quiet,      SingleThreaded, TapOnly>>("Quiet, SingleThreaded, TapOnly", n);
+
+	/* Keep the global context from printing a plan */
+	plan(SKIP_ALL, "benchmarks");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#include <tappp.hpp>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <system_error>
+#include <cstdlib>
+
+using namespace TAP;
+
+static std::uint64_t sum(const std::uint64_t* p, std::size_t n) {
+	return std::accumulate(p, p + n, std::uint64_t(0));
+}
+
+int main(void) {
+	plan(12);
+
+	const std::size_t size = 8 << 20, n = size / sizeof(std::uint64_t);
+
+	Bench::Buffer buf(size);
+	is(buf.size(), size, "size");
+	ok(reinterpret_cast<std::uintptr_t>(buf.data()) % Bench::Buffer::huge_page() == 0,
+	    "aligned to a huge page");
+	note("backed by huge pages: ", buf.huge_bytes(), " bytes");
+
+	std::uint64_t total = 1;
+	auto region = Bench::timed([&] { total = sum(buf.as<std::uint64_t>(), n); });
+	is(total, 0U, "contents are zero");
+	is(region.minor_faults, 0U, "no minor faults in the timed region");
+	is(region.major_faults, 0U, "no major faults in the timed region");
+	note(region);
+
+	Bench::Buffer plain(size, Bench::Pages::Base);
+	auto fill = Bench::timed([&] { std::iota(plain.as<std::uint64_t>(), plain.as<std::uint64_t>() + n, 0); });
+	is(fill.minor_faults, 0U, "base pages are pre-faulted, too");
+
+	std::unique_ptr<std::uint64_t[]> fresh(new std::uint64_t[n]);
+	auto cold = Bench::timed([&] { std::iota(fresh.get(), fresh.get() + n, 0); });
+	ok(cold.minor_faults > 0, "fresh heap memory faults");
+
+#ifdef __linux__
+	/* Faults of another thread during the timed region do not count */
+	std::atomic<int> phase{0};
+	std::unique_ptr<std::uint64_t[]> other(new std::uint64_t[n]);
+	std::thread faulter([&] {
+		while (phase == 0)
+			std::this_thread::yield();
+		std::iota(other.get(), other.get() + n, 0);
+		phase = 2;
+	});
+	auto quiet = Bench::timed([&] {
+		phase = 1;
+		while (phase != 2)
+			std::this_thread::yield();
+	});
+	faulter.join();
+	ok(quiet.minor_faults < size / 4096 / 2, "faults of other threads are not counted");
+	ok(quiet.process_minor_faults >= size / 4096 / 2, "but counted for the process");
+#else
+	SKIP(2, "per-thread usage is Linux only");
+#endif
+
+	Bench::Buffer moved = std::move(plain);
+	is(moved.as<std::uint64_t>()[n - 1], n - 1, "buffers can be moved");
+
+	lives([] { Bench::Buffer small(4096, Bench::Pages::Base, true); }, "locking");
+
+	try {
+		Bench::Buffer huge(Bench::Buffer::huge_page(), Bench::Pages::HugeTLB);
+		is(huge.huge_bytes(), Bench::Buffer::huge_page(), "hugetlbfs pages");
+	}
+	catch (const std::system_error&) {
+		SKIP(1, "no hugetlbfs pages reserved");
+	}
+
+	return EXIT_SUCCESS;
+}
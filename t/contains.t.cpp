@@ -0,0 +1,41 @@
+#include <tappp.hpp>
+#include <string>
+#include <cstdlib>
+
+using namespace TAP;
+
+int main(void) {
+	plan(7);
+
+	std::string log =
+		"starting up\n"
+		"connected to db\n"
+		"ERROR: lost connection\n"
+		"reconnected\n"
+		"shutting down, leak of 64 bytes\n";
+
+	Patterns forbidden{"ERROR", "leak", "assertion"};
+	contains_any(log, forbidden, "something went wrong");
+	TODO("the log has errors");
+	contains_none(log, forbidden, "nothing went wrong");
+	contains_none("all good\n", forbidden, "patterns are reusable");
+
+	contains_all(log, {"starting", "shutting"}, "log is complete");
+	TODO("a line is missing");
+	contains_all(log, {"starting", "finished", "shutting"}, "log is really complete");
+
+	/* Overlapping patterns and patterns which are suffixes of others */
+	Patterns overlap{"he", "she", "hers", "his"};
+	std::size_t hits = 0;
+	overlap.scan("ushers", [&] (const Patterns::Hit&) {
+		++hits;
+		return true;
+	});
+	is(hits, 3U, "all overlapping occurrences are found");
+
+	std::string big(1 << 20, 'x');
+	big += "needle";
+	contains_any(big, {"needle", "haystack"}, "single pass over a large text");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include <tappp.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace TAP;
+
+static std::string slurp(const std::string& path) {
+	std::ifstream in(path);
+	std::stringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+/* Called by one subtest each, to select on changes to their lines */
+static const unsigned int twice_line = __LINE__ + 2;
+static int twice(int x) {
+	return 2 * x;
+}
+
+static const unsigned int square_line = __LINE__ + 2;
+static int square(int x) {
+	return x * x;
+}
+
+int main(void) {
+	plan(10);
+
+	std::string map = "/tmp/tappp-coverage-" + std::to_string(::getpid()) + ".map";
+	std::remove(map.c_str());
+
+	int fixture = 0;
+	Suite suite;
+	suite.setup([&] { fixture = 1; });
+	suite.add("first", [&] (Context& t) {
+		t.is(fixture, 1, "fixture set up");
+		t.is(twice(fixture), 2, "twice");
+	});
+	suite.add("second", [&] (Context& t) {
+		t.is(square(fixture + 2), 9, "square");
+	});
+
+	{
+		std::stringstream out;
+		Context ctx(out);
+		suite.record_coverage(map).run(ctx);
+		suite.record_coverage("");
+	}
+	std::string recorded = slurp(map);
+	like(recorded, "[\\s\\S]*F t/coverage\\.t\\.cpp\\n[\\s\\S]*T [0-9:,;-]+ first\\nT [0-9:,;-]+ second\\n",
+		"map records the executed lines of every subtest");
+
+	auto selected = [&] (const std::vector<std::string>& changed) {
+		std::stringstream out;
+		{
+			Context ctx(out);
+			suite.select_affected(map, changed).run(ctx);
+		}
+		return out.str();
+	};
+	like(selected({ }), "ok 1 - first # SKIP unaffected\nok 2 - second # SKIP unaffected\n1..2\n",
+		"nothing changed, nothing runs");
+	like(selected({ "t/coverage.t.cpp" }), "[\\s\\S]*\nok 1 - first\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"changed test program runs everything");
+	like(selected({ "tappp.hpp" }), "[\\s\\S]*\nok 1 - first\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"changed header runs everything");
+	std::string file = "t/coverage.t.cpp:";
+	like(selected({ file + std::to_string(twice_line) }), "[\\s\\S]*\nok 1 - first\nok 2 - second # SKIP unaffected\n1..2\n",
+		"edit to a function runs only the subtest calling it");
+	like(selected({ file + std::to_string(square_line - 1) + "-" + std::to_string(square_line + 1) }),
+		"ok 1 - first # SKIP unaffected\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"and so does an edit to a range of lines");
+	like(selected({ file + std::to_string(twice_line - 3) }), "ok 1 - first # SKIP unaffected\nok 2 - second # SKIP unaffected\n1..2\n",
+		"edit to lines not executed by a subtest runs nothing");
+
+	{
+		std::ofstream out(map);
+		out << "F src/parse.cpp\nF src/eval.cpp\nF include/print.hpp\n"
+		    << "T 0:1-5 first\nT 1:10-20,30;2:3 second\n";
+	}
+	like(selected({ "src/eval.cpp" }), "ok 1 - first # SKIP unaffected\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"only the subtest covering the changed file runs");
+	like(selected({ "/home/me/project/include/print.hpp:1-3", "src/parse.cpp:5" }), "    ok 1[\\s\\S]*\nok 1 - first\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"files relative to other directories match");
+	like(selected({ "src/eval.cpp:21-29", "Makefile" }), "    ok 1[\\s\\S]*\nok 1 - first\n[\\s\\S]*\nok 2 - second\n1..2\n",
+		"changed file outside of the map runs everything");
+	std::remove(map.c_str());
+
+	return EXIT_SUCCESS;
+}
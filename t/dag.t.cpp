@@ -0,0 +1,96 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(7);
+
+	std::atomic<int> index{0};
+	/* Count the sleeping subtests to see whether they overlap */
+	std::atomic<int> sleeping{0}, overlap{0};
+	auto nap = [&] {
+		int now = ++sleeping;
+		int seen = overlap.load();
+		while (now > seen and not overlap.compare_exchange_weak(seen, now))
+			;
+		std::this_thread::sleep_for(50ms);
+		--sleeping;
+	};
+	Suite suite;
+	suite.add("build index", [&] (Context& t) {
+		nap();
+		index = 42;
+		t.pass("built");
+	});
+	suite.add("query index", {"build index"}, [&] (Context& t) {
+		t.is(index.load(), 42, "index is there");
+	});
+	suite.add("independent", [&] (Context& t) {
+		nap();
+		t.pass("runs concurrently");
+	});
+	suite.add("broken", [&] (Context& t) {
+		t.fail("always");
+	});
+	suite.add("needs broken", {"broken"}, [&] (Context& t) {
+		t.fail("never runs");
+	});
+	suite.add("transitive", {"needs broken", "build index"}, [&] (Context& t) {
+		t.fail("never runs either");
+	});
+
+	std::stringstream out;
+	{
+		Context ctx(out);
+		suite.run_parallel(ctx, 4);
+	}
+
+	like(out.str(), "[\\s\\S]*\nok 1 - build index\n[\\s\\S]*\nok 2 - query index\n"
+		"[\\s\\S]*\nok 3 - independent\n[\\s\\S]*\nnot ok 4 - broken\n"
+		"    1..0 # SKIP dependency failed\nok 5 - needs broken # SKIP dependency failed\n"
+		"    1..0 # SKIP dependency failed\nok 6 - transitive # SKIP dependency failed\n1..6\n",
+		"output in declaration order with skipped dependents");
+	is(overlap.load(), 2, "independent branches run concurrently");
+
+	std::stringstream serial;
+	{
+		Context ctx(serial);
+		suite.run(ctx);
+	}
+	is(serial.str(), out.str(), "serial runs skip dependents, too");
+
+	std::stringstream selected;
+	index = 0;
+	{
+		Context ctx(selected);
+		suite.run(ctx, {"query index", "needs broken", "build index"});
+	}
+	like(selected.str(), "[\\s\\S]*\nok 1 - build index\n[\\s\\S]*\nok 2 - query index\n"
+		"[\\s\\S]*\nnot ok 3 - broken\n"
+		"    1..0 # SKIP dependency failed\nok 4 - needs broken # SKIP dependency failed\n1..4\n",
+		"selected subtests pull in their dependencies");
+
+	throws<std::invalid_argument>([&] {
+		suite.add("dangling", {"later"}, [] (Context&) { });
+	}, "dependencies must be declared first");
+
+	std::stringstream single;
+	{
+		Context ctx(single);
+		suite.run_parallel(ctx, 1);
+	}
+	is(single.str(), out.str(), "output does not depend on the number of threads");
+
+	Suite empty;
+	lives([&] { empty.run_parallel(*TAPP); }, "empty suite");
+
+	return EXIT_SUCCESS;
+}
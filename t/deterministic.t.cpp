@@ -0,0 +1,94 @@
+#include <tappp.hpp>
+#include <array>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+
+/* Sum a vector in `threads` chunks and combine the partial sums. */
+template<typename T>
+static T chunked_sum(const std::vector<T>& v, unsigned int threads, bool fixed_order) {
+	std::size_t chunks = fixed_order ? 16 : threads;
+	std::vector<T> partial(chunks);
+	std::vector<std::thread> pool;
+	for (std::size_t c = 0; c < chunks; ++c) {
+		pool.emplace_back([&, c] {
+			for (std::size_t i = c * v.size() / chunks; i < (c + 1) * v.size() / chunks; ++i)
+				partial[c] += v[i];
+		});
+	}
+	for (auto& th : pool)
+		th.join();
+	T sum = 0;
+	for (auto x : partial)
+		sum += x;
+	return sum;
+}
+
+int main(void) {
+	plan(9);
+
+	std::vector<double> v;
+	for (int i = 1; i <= 100000; ++i)
+		v.push_back(1.0 / i);
+
+	deterministic([&] (unsigned int threads) {
+		return chunked_sum(v, threads, true);
+	}, 3, {1, 2, 4, 8}, "fixed chunking is reproducible");
+
+	TODO("floating-point addition is not associative");
+	deterministic([&] (unsigned int threads) {
+		return chunked_sum(v, threads, false);
+	}, 2, {1, 3, 7}, "chunking by thread count is not");
+
+	deterministic([&] (unsigned int threads) {
+		return std::string(threads, ' ').substr(0, 1) + "same";
+	}, 2, {1, 2}, "strings are compared bytewise");
+
+	deterministic([&] (unsigned int threads) {
+		double sum = chunked_sum(v, threads, true);
+		return std::array<double, 2>{ sum, -sum };
+	}, 1, {1, 4}, "arrays of doubles have no padding");
+
+	TODO("vectors of different lengths");
+	deterministic([&] (unsigned int threads) {
+		return std::vector<int>(threads, 0);
+	}, 1, {1, 2}, "sizes differ");
+
+	/* Tasks append their index in the order in which they run */
+	Executor ex(4);
+	auto order = [&] (unsigned int) {
+		std::mutex mtx;
+		std::vector<int> seen;
+		Executor::Group group(ex);
+		for (int i = 0; i < 8; ++i) {
+			group.run([&, i] {
+				std::lock_guard<std::mutex> lock(mtx);
+				seen.push_back(i);
+			});
+		}
+		group.wait();
+		return seen;
+	};
+	std::stringstream out;
+	bool caught;
+	{
+		Context ctx(out);
+		caught = not ctx.deterministic(order, 20, {4});
+	}
+	ok(caught, "perturbed schedules expose order-dependent results");
+	like(out.str(), "[\\s\\S]*# schedule perturbed with seed [0-9]+\n[\\s\\S]*", "perturbation seed diagnosed");
+
+	throws<std::invalid_argument>([&] {
+		deterministic([] (unsigned int) { return 0; }, 0, {1});
+	}, "no runs are rejected");
+	throws<std::invalid_argument>([&] {
+		deterministic([] (unsigned int) { return 0; }, 1, {});
+	}, "no thread counts are rejected");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+using namespace TAP;
+
+/* Diagnosed by reference: copying it would not compile */
+struct Heavy {
+	std::string data = std::string(3, 'x');
+	Heavy(void) = default;
+	Heavy(const Heavy&) = delete;
+};
+
+std::ostream& operator<<(std::ostream& os, const Heavy& h) {
+	return os << "heavy " << h.data;
+}
+
+/* Counts how often the sink is flushed */
+struct Flushes : std::stringbuf {
+	int count = 0;
+	int sync(void) override {
+		++count;
+		return std::stringbuf::sync();
+	}
+};
+
+int main(void) {
+	plan(8);
+
+	std::stringstream out, err;
+	{
+		Context ctx(out);
+		ctx.diagnostics(&err);
+		Heavy h;
+		ctx.note("note ", h);
+		ctx.diag("diag ", h);
+		ctx.is(1, 2, "differs");
+		ctx.subtest("inner", [] (Context& t) {
+			t.diag("from the subtest");
+			t.note("noted in the subtest");
+		});
+		ctx.diagnostics(nullptr);
+		ctx.diag("back on the stream");
+	}
+
+	is(out.str(), "# note heavy xxx\nnot ok 1 - differs\n"
+		"    # noted in the subtest\n    1..0\nok 2 - inner\n"
+		"# back on the stream\n1..2\n", "notes and tests on the TAP stream");
+	like(err.str(), "# diag heavy xxx\n[\\s\\S]*", "diag on the sink");
+	like(err.str(), "[\\s\\S]*\n# Expected: '2'\n#      Got: '1'\n[\\s\\S]*", "failure diagnostics on the sink");
+	like(err.str(), "[\\s\\S]*\n    # from the subtest\n", "subtests inherit the sink");
+	unlike(err.str(), "[\\s\\S]*(noted|back on)[\\s\\S]*", "nothing else on the sink");
+
+	/* Thread subtests finish in reverse order but are merged in order */
+	std::stringstream tout, terr;
+	{
+		Context ctx(tout);
+		ctx.diagnostics(&terr);
+		std::vector<Context*> subs;
+		for (int i = 0; i < 3; ++i)
+			subs.push_back(ctx.thread_subtest("thread " + std::to_string(i)));
+		for (int i = 2; i >= 0; --i) {
+			std::thread([&, i] {
+				subs[i]->diag("from thread ", i);
+				subs[i]->pass();
+			}).join();
+		}
+		is(terr.str(), "", "thread subtests buffer their diagnostics");
+		ctx.merge();
+	}
+	is(terr.str(), "    # from thread 0\n    # from thread 1\n    # from thread 2\n",
+		"and write them to the sink in merge order");
+
+	Flushes flushes;
+	std::ostream sink(&flushes);
+	{
+		std::stringstream out;
+		Context ctx(out);
+		ctx.diagnostics(&sink, false);
+		for (int i = 0; i < 3; ++i)
+			ctx.diag("buffered ", i);
+	}
+	ok(flushes.count == 0 and flushes.str() == "# buffered 0\n# buffered 1\n# buffered 2\n",
+		"a buffered sink is not flushed per message");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include <tappp.hpp>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+
+static unsigned long popcount_ref(unsigned long x) {
+	unsigned long n = 0;
+	for (; x; x >>= 1)
+		n += x & 1;
+	return n;
+}
+
+static unsigned long popcount_fast(unsigned long x) {
+	return __builtin_popcountl(x);
+}
+
+static int parse_ref(const std::string& s) {
+	return std::stoi(s);
+}
+
+static int parse_buggy(const std::string& s) {
+	int n = 0;
+	for (char c : s)
+		n = 10 * n + (c - '0');
+	return n;
+}
+
+int main(void) {
+	plan(8);
+
+	same_behavior(popcount_ref, popcount_fast,
+		[] (std::size_t i) { return i * 2654435761UL; }, 10000,
+		"popcount implementations agree");
+
+	std::vector<std::string> corpus{"0", "1", "42", "1000", "123456"};
+	same_behavior(parse_ref, parse_buggy, corpus, 100, "parsers agree on digits");
+
+	corpus.push_back("-5");
+	TODO("the fast parser does not know signs");
+	same_behavior(parse_ref, parse_buggy, corpus, 100, "parsers agree on signs");
+
+	corpus = {"", "x"};
+	same_behavior(parse_ref, [] (const std::string& s) -> int {
+		throw std::invalid_argument("stoi");
+		return s.size();
+	}, corpus, 2, "exceptions are compared");
+
+	/* The divergence at input 0 stops impl within the first batch */
+	std::atomic<std::size_t> calls{0};
+	std::stringstream out;
+	{
+		Context ctx(out);
+		ctx.same_behavior([] (std::size_t i) { return i; }, [&] (std::size_t i) {
+			++calls;
+			return i == 0 ? 1 : i;
+		}, [] (std::size_t i) { return i; }, 100000, "m");
+	}
+	std::size_t batch = 64 * Executor::shared().size();
+	ok(calls < batch, "impl stops at the first divergence, not at the end of its batch");
+	like(out.str(), "not ok 1 - m\n# implementations diverge at input #0\n[\\s\\S]*", "the first diverging input is reported");
+
+	::unsetenv("TAPPP_VERBOSE");
+	std::stringstream quiet, verbose;
+	{
+		Context ctx(quiet);
+		ctx.same_behavior(popcount_ref, popcount_fast, [] (std::size_t i) { return i; }, 100, "m");
+	}
+	is(quiet.str(), "ok 1 - m\n1..1\n", "no speedup diagnostic by default");
+	::setenv("TAPPP_VERBOSE", "1", 1);
+	{
+		Context ctx(verbose);
+		ctx.same_behavior(popcount_ref, popcount_fast, [] (std::size_t i) { return i; }, 100, "m");
+	}
+	::unsetenv("TAPPP_VERBOSE");
+	like(verbose.str(), "ok 1 - m\n# speedup of impl over ref: [\\s\\S]*x on 100 inputs\n1..1\n", "but with TAPPP_VERBOSE");
+
+	return EXIT_SUCCESS;
+}
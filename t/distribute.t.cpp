@@ -0,0 +1,81 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <set>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <signal.h>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(6);
+
+	std::string marker = "/tmp/tappp-distribute-" + std::to_string(::getpid());
+	std::remove(marker.c_str());
+
+	int fixture = 0;
+	Suite suite;
+	suite.setup([&] { fixture = 42; });
+	suite.add("slow", [&] (Context& t) {
+		std::this_thread::sleep_for(60ms);
+		t.is(fixture, 42, "fixture shared with workers");
+		t.diag("pid ", ::getpid());
+	});
+	for (int k = 0; k < 4; ++k) {
+		suite.add("quick " + std::to_string(k), [&] (Context& t) {
+			std::this_thread::sleep_for(10ms);
+			t.pass("quick");
+			t.diag("pid ", ::getpid());
+		});
+	}
+	suite.add("flaky", [&] (Context& t) {
+		/* Crash the first worker which runs this */
+		if (FILE* f = std::fopen(marker.c_str(), "wx")) {
+			std::fclose(f);
+			::raise(SIGKILL);
+		}
+		t.pass("survived the retry");
+	});
+	suite.add("doomed", [&] (Context& t) {
+		t.pass("before the crash");
+		::raise(SIGKILL);
+	});
+	suite.add("after doomed", {"doomed"}, [&] (Context& t) {
+		t.fail("never runs");
+	});
+
+	std::stringstream out;
+	{
+		Context ctx(out);
+		suite.distribute(ctx, 3);
+	}
+	std::string tap = out.str();
+	std::remove(marker.c_str());
+
+	like(tap, "[\\s\\S]*\nok 1 - slow\n[\\s\\S]*\nok 2 - quick 0\n[\\s\\S]*\nok 5 - quick 3\n"
+		"[\\s\\S]*\nok 6 - flaky\n[\\s\\S]*\nnot ok 7 - doomed\n"
+		"    1..0 # SKIP dependency failed\nok 8 - after doomed # SKIP dependency failed\n1..8\n",
+		"results in order of registration");
+	like(tap, "[\\s\\S]*    # retried after worker crash\n    ok 1 - survived the retry\n[\\s\\S]*",
+		"crashed subtest retried");
+	like(tap, "[\\s\\S]*    not ok 1 - worker process crashed\n    # worker crashed twice, last killed by signal 9\n[\\s\\S]*",
+		"repeated crash fails the subtest");
+	unlike(tap, "[\\s\\S]*before the crash[\\s\\S]*", "output of crashed worker discarded");
+
+	std::set<std::string> pids;
+	std::istringstream lines(tap);
+	for (std::string line; std::getline(lines, line); ) {
+		auto at = line.find("# pid ");
+		if (at != std::string::npos)
+			pids.insert(line.substr(at + 6));
+	}
+	ok(pids.size() > 1, "subtests ran on several workers");
+	ok(pids.count(std::to_string(::getpid())) == 0, "no subtest ran in the coordinator");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#include <tappp.hpp>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(5);
+
+	Histogram h;
+	for (unsigned int i = 1; i <= 1000; ++i)
+		h.record(i * 1000);
+	is(h.count(), 1000U, "histogram counts values");
+	ok(h.percentile(0.5) >= 500000 && h.percentile(0.5) <= 500000 * 17 / 16,
+		"median within bucket resolution");
+	is(h.percentile(1.0), h.max(), "100th percentile is the maximum");
+
+	SUBTEST("soak in windows") {
+		Endurance soak(*TAPP, 60ms, 20ms);
+		unsigned long iterations = 0;
+		while (soak.running()) {
+			auto x = soak.measure([&] {
+				std::this_thread::sleep_for(1ms);
+				return ++iterations;
+			});
+			soak->ok(x > 0, "handler returned");
+		}
+	};
+
+	Histogram a, b;
+	a.record(10ms);
+	b.record(20ms);
+	a.merge(b);
+	is(a.max(), std::uint64_t(20000000), "merged histograms");
+
+	return EXIT_SUCCESS;
+}
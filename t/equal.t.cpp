@@ -0,0 +1,88 @@
+#include <tappp.hpp>
+#include <string>
+#include <string_view>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <streambuf>
+
+using namespace TAP;
+
+/* Allocations made through the global operator new */
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+	++allocations;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+/* Swallows the TAP without allocating */
+struct Discard : std::streambuf {
+	int overflow(int c) override {
+		return traits_type::not_eof(c);
+	}
+};
+
+struct Meters {
+	double value;
+	bool operator==(double other) const { return value == other; }
+};
+
+int main(void) {
+	plan(19);
+
+	std::string s = "abc";
+	std::string_view sv = "abc";
+	char buf[] = "abc";
+	const char* p = buf;
+	const char* null = nullptr;
+
+	is(s, "abc", "std::string against a literal");
+	is(sv, "abc", "std::string_view against a literal");
+	is(sv, s, "std::string_view against std::string");
+	is(p, "abc", "C strings are compared by content");
+	is(buf, s, "character array against std::string");
+	isnt(null, "", "null pointer is not the empty string");
+	is(null, null, "two null pointers are equal");
+	is(null, nullptr, "null C string against nullptr");
+	isnt(p, nullptr, "non-null C string against nullptr");
+
+	isnt(-1, UINT_MAX, "-1 is not UINT_MAX");
+	isnt(UINT_MAX, -1, "UINT_MAX is not -1");
+	is(3u, 3, "unsigned against signed");
+	is(std::size_t(7), short(7), "different widths");
+	is('a', 97, "character types keep their promotion");
+	isnt(std::int8_t(-1), std::uint8_t(255), "int8_t and uint8_t are integers");
+	ok(not Equal{}(std::int8_t(-1), 255u), "int8_t against unsigned by value");
+
+	is(Meters{1.5}, 1.5, "custom operator==");
+
+	ok(Equal{}(std::string("x"), "x"), "Equal is usable directly");
+
+	{
+		Discard discard;
+		std::ostream quiet(&discard);
+		Context ctx(quiet);
+		std::string got = "value";
+		std::size_t before = allocations;
+		ctx.is(got, "value", "a message too long for the small string optimization");
+		ctx.isnt(got, "other", "another message too long for the small string optimization");
+		std::size_t made = allocations - before;
+		ctx.done_testing();
+		is(made, 0U, "passing is and isnt do not allocate");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include <tappp.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+/* CPU seconds used by the clock `id` */
+static double cpu(clockid_t id) {
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Naive Fibonacci with a nested group per call */
+static unsigned long fib(Executor& ex, unsigned int n) {
+	if (n < 2)
+		return n;
+	unsigned long a = 0, b = 0;
+	Executor::Group group(ex);
+	group.run([&] { a = fib(ex, n - 1); });
+	b = fib(ex, n - 2);
+	group.wait();
+	return a + b;
+}
+
+int main(void) {
+	plan(14);
+
+	/* Two jobs where possible, to tell them from a single worker */
+	unsigned int two = std::min(2U, cpu_count());
+	::setenv("TAPPP_JOBS", std::to_string(two).c_str(), 1);
+	is(jobs(), two, "TAPPP_JOBS sets the number of jobs");
+	is(Executor::shared().size(), two, "shared executor is sized by it");
+	ok(&Executor::shared() == &Executor::shared(), "there is one shared executor");
+	::setenv("TAPPP_JOBS", "100000", 1);
+	is(jobs(), cpu_count(), "TAPPP_JOBS is clamped to the CPUs");
+	::unsetenv("TAPPP_JOBS");
+	ok(jobs() == cpu_count() and jobs() >= 1, "at least one job without TAPPP_JOBS");
+
+#ifdef __linux__
+	cpu_set_t all, one;
+	::sched_getaffinity(0, sizeof(all), &all);
+	CPU_ZERO(&one);
+	for (int c = 0; c < CPU_SETSIZE; ++c) {
+		if (CPU_ISSET(c, &all)) {
+			CPU_SET(c, &one);
+			break;
+		}
+	}
+	::sched_setaffinity(0, sizeof(one), &one);
+	is(cpu_count(), 1U, "affinity mask bounds the CPUs");
+	::sched_setaffinity(0, sizeof(all), &all);
+
+	/* A fake cgroup tree: v1 lines are ignored, the tightest quota
+	 * of the cgroup and its ancestors counts */
+	fs::path root = "/tmp/tappp-cgroup-" + std::to_string(::getpid());
+	fs::create_directories(root / "a" / "b");
+	std::ofstream(root / "self") << "1:cpu:/v1\n0::/a/b\n";
+	std::ofstream(root / "a" / "cpu.max") << "150000 100000\n";
+	std::ofstream(root / "a" / "b" / "cpu.max") << "max 100000\n";
+	is(cgroup_cpus(root / "self", root), 2U, "cpu.max quota of an ancestor, rounded up");
+	std::ofstream(root / "a" / "b" / "cpu.max") << "50000 100000\n";
+	std::ofstream(root / "v1") << "1:cpu:/a/b\n";
+	ok(cgroup_cpus(root / "self", root) == 1 and cgroup_cpus(root / "v1", root) == 0,
+		"tightest quota counts, cgroup v1 has none");
+	fs::remove_all(root);
+#else
+	SKIP(3, "Linux only");
+#endif
+
+	Executor ex(4);
+	std::atomic<unsigned int> count{0};
+	{
+		Executor::Group group(ex);
+		for (int i = 0; i < 1000; ++i)
+			group.run([&] { ++count; });
+		group.wait();
+	}
+	is(count.load(), 1000U, "all tasks of a group run");
+
+	is(fib(ex, 20), 6765UL, "nested groups do not deadlock");
+
+	std::mutex mtx;
+	std::set<std::thread::id> ids;
+	{
+		Executor::Group outer(ex);
+		outer.run([&] {
+			Executor::Group inner(ex);
+			for (int i = 0; i < 40; ++i) {
+				inner.run([&] {
+					std::this_thread::sleep_for(1ms);
+					std::lock_guard<std::mutex> lock(mtx);
+					ids.insert(std::this_thread::get_id());
+				});
+			}
+			inner.wait();
+		});
+		outer.wait();
+	}
+	ok(ids.size() > 1, "tasks pushed by one worker are stolen by others");
+
+	/* A waits for its inner task, which the other worker runs, while
+	 * an unrelated task B is queued: A's thread must not run B */
+	{
+		Executor two(2);
+		static thread_local bool waiting = false;
+		std::atomic<bool> started{false}, in_wait{false}, nested{false};
+		Executor::Group outer(two), unrelated(two);
+		outer.run([&] {
+			Executor::Group inner(two);
+			inner.run([&] {
+				started = true;
+				std::this_thread::sleep_for(100ms);
+			});
+			while (not started)
+				std::this_thread::yield();
+			waiting = in_wait = true;
+			inner.wait();
+			waiting = false;
+		});
+		while (not in_wait)
+			std::this_thread::yield();
+		unrelated.run([&] { nested = waiting; });
+		std::this_thread::sleep_for(20ms);
+		unrelated.wait();
+		outer.wait();
+		ok(not nested, "waiting threads do not run unrelated tasks");
+	}
+
+	throws<std::runtime_error>([&] {
+		Executor::Group group(ex);
+		group.run([] { throw std::runtime_error("boom"); });
+		group.wait();
+	}, "exceptions of tasks are rethrown by wait");
+
+	/* CPU time of the workers only, at best over a few tries */
+	double busy = 1;
+	for (int i = 0; i < 3; ++i) {
+		double before = cpu(CLOCK_PROCESS_CPUTIME_ID) - cpu(CLOCK_THREAD_CPUTIME_ID);
+		std::this_thread::sleep_for(100ms);
+		busy = std::min(busy, cpu(CLOCK_PROCESS_CPUTIME_ID) - cpu(CLOCK_THREAD_CPUTIME_ID) - before);
+	}
+	ok(busy < 0.02, "idle workers park");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include <tappp.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace TAP;
+namespace fs = std::filesystem;
+
+int main(void) {
+	plan(9);
+
+	fs::path path = fs::temp_directory_path() /
+	    ("tappp-fileio-" + std::to_string(::getpid()));
+	{
+		std::ofstream out(path, std::ios::binary);
+		std::string chunk(1 << 16, 'x');
+		for (int i = 0; i < 64; ++i)
+			out << chunk;
+	}
+	const std::uint64_t size = 64 << 16;
+
+	Bench::FileIO io;
+	io.files = { path.string() };
+	io.block = 1 << 16;
+
+	auto count = Bench::read_files(io);
+	is(count.bytes, size, "read_files reads whole files");
+	is(count.ops, 64U, "in blocks of the given size");
+
+	ok(Bench::cached_fraction(io.files) > 0.5, "a read file is cached");
+	Bench::evict(io.files);
+	double left = Bench::cached_fraction(io.files);
+	if (left < 1)
+		ok(left < 0.05, "evicted files are not cached");
+	else
+		SKIP(1, "file system keeps files in memory");
+
+	auto report = Bench::file_io(io);
+	is(report.cold.runs, 3U, "cold runs");
+	is(report.warm.bytes, 3 * size, "bytes of warm runs");
+	ok(report.cold.throughput() > 0 and report.warm.iops() > 0, "throughput and IOPS");
+	note(report);
+
+	io.direct = true;
+	try {
+		auto direct = Bench::read_files(io);
+		is(direct.bytes, size, "direct reads");
+	}
+	catch (const std::system_error&) {
+		SKIP(1, "no direct I/O here");
+	}
+
+	io.files = { (path.string() + ".missing") };
+	throws<std::system_error>([&] { Bench::file_io(io); }, "missing files throw");
+
+	fs::remove(path);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+static std::atomic<int> built{0}, destroyed{0};
+
+struct Table {
+	std::vector<int> squares;
+	Table(int n) {
+		++built;
+		std::this_thread::sleep_for(30ms);
+		for (int i = 0; i < n; ++i)
+			squares.push_back(i * i);
+	}
+	Table(Table&& other) : squares(std::move(other.squares)) {
+		++built;
+	}
+	~Table(void) {
+		if (not squares.empty())
+			++destroyed;
+	}
+};
+
+int main(void) {
+	plan(7);
+
+	std::stringstream out;
+	const Table* seen[8] = { };
+	{
+		Context ctx(out);
+		std::vector<std::thread> pool;
+		for (int k = 0; k < 8; ++k) {
+			Context* sub = ctx.thread_subtest("user " + std::to_string(k));
+			pool.emplace_back([sub, &seen, k] {
+				const Table& t = sub->fixture<Table>([] { return Table(100); });
+				seen[k] = &t;
+				sub->is(t.squares.at(9), 81, "lookup");
+			});
+		}
+		for (auto& th : pool)
+			th.join();
+		ctx.merge();
+
+		ctx.subtest("nested", [] (Context& t) {
+			t.subtest("deeper", [] (Context& u) {
+				const Table& table = u.fixture<Table>([] { return Table(1); });
+				u.is(table.squares.size(), 100UL, "same fixture in nested subtests");
+			});
+		});
+
+		const Table& small = ctx.fixture<Table>("small", [] { return Table(3); });
+		ctx.is(small.squares.size(), 3UL, "named fixture is separate");
+
+		int tries = 0;
+		try {
+			ctx.fixture<int>("flaky", [&] () -> int { ++tries; throw std::runtime_error("not yet"); });
+		}
+		catch (const std::runtime_error&) { }
+		ctx.is(ctx.fixture<int>("flaky", [&] { return ++tries; }), 2, "failed factory tried again");
+
+		is(destroyed.load(), 0, "alive until done_testing");
+	}
+
+	bool same = true;
+	for (auto p : seen)
+		same = same and p == seen[0];
+	ok(same, "one instance shared by all threads");
+	is(destroyed.load(), 2, "torn down at top-level done_testing");
+	std::string tap = out.str();
+	like(tap, "[\\s\\S]*# fixture [^\\n]* set up in [0-9.e-]+s\n[\\s\\S]*", "construction time diagnosed");
+	std::size_t diags = 0;
+	for (auto at = tap.find("set up in"); at != std::string::npos; at = tap.find("set up in", at + 1))
+		++diags;
+	is(diags, 3UL, "constructed once per fixture");
+	like(tap, "[\\s\\S]*ok 1 - user 0\n[\\s\\S]*ok 8 - user 7\n[\\s\\S]*ok 9 - nested\n"
+		"[\\s\\S]*\nok 10 - named fixture is separate\n[\\s\\S]*\nok 11 - failed factory tried again\n1..11\n",
+		"subtests pass");
+	is(built.load(), 2 + 2, "factories called once, moved once");
+
+	return EXIT_SUCCESS;
+}
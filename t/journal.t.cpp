@@ -0,0 +1,158 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <regex>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace TAP;
+
+/* Run three subtests on `ctx` and count how many bodies were executed. */
+static int suite(Context& ctx) {
+	int executed = 0;
+	const char* names[] = { "build", "query", "teardown" };
+	for (auto name : names) {
+		std::unique_ptr<Context> sub(ctx.subtest(name));
+		if (sub->resumed())
+			continue;
+		++executed;
+		sub->ok(std::string(name) != "query", name);
+		sub->done_testing();
+		if (std::string(name) == "query") {
+			ctx.BAIL("simulated crash");
+			break;
+		}
+	}
+	return executed;
+}
+
+int main(void) {
+	plan(15);
+
+	std::string path = "/tmp/tappp-journal-" + std::to_string(getpid());
+
+	std::stringstream first;
+	{
+		Context ctx(first);
+		ctx.journal(path);
+		is(suite(ctx), 2, "interrupted run executes two subtests");
+	}
+
+	std::ifstream in(path);
+	std::string journal((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	is(journal, std::string("ok\tbuild\nnot ok\tquery\n"), "journal records finished subtests");
+
+	{
+		std::stringstream died;
+		Context ctx(died);
+		ctx.journal(path, true);
+		std::unique_ptr<Context> sub(ctx.subtest("build"));
+		ok(sub->resumed() and sub->summary(), "passed subtest is replayed");
+		ctx.BAIL("dies before replaying everything");
+	}
+	std::ifstream again(path);
+	std::string kept((std::istreambuf_iterator<char>(again)), std::istreambuf_iterator<char>());
+	is(kept, journal, "interrupted resumed run keeps the journal");
+
+	{
+		std::stringstream died;
+		Context ctx(died);
+		ctx.journal(path, true);
+		std::unique_ptr<Context> sub(ctx.subtest("build"));
+		sub.reset(ctx.subtest("query"));
+		ok(sub->resumed() and not sub->summary(), "failed subtest is replayed as failed");
+		sub.reset();
+		ctx.BAIL("dies again");
+	}
+
+	std::stringstream second;
+	int executed;
+	{
+		Context ctx(second);
+		ctx.journal(path, true);
+		executed = suite(ctx);
+	}
+	is(executed, 1, "resumed run executes only the unfinished subtest");
+	like(second.str(), "[\\s\\S]*\nok 1 - build\n[\\s\\S]*\nnot ok 2 - query\n[\\s\\S]*\nok 3 - teardown\n1..3\n",
+		"replayed results keep their numbers");
+	ok(access(path.c_str(), F_OK) != 0, "complete run removes the journal");
+
+	std::stringstream third;
+	{
+		Context ctx(third);
+		ctx.journal(path, true);
+		executed = suite(ctx);
+	}
+	is(executed, 2, "missing journal starts from the beginning");
+	unlink(path.c_str());
+
+	/* Descriptions with tabs and newlines and thread subtests */
+	const std::string odd = "tab\there\nnewline \\t";
+	{
+		std::stringstream out;
+		Context ctx(out);
+		ctx.journal(path);
+		std::unique_ptr<Context> sub(ctx.subtest(odd));
+		sub->pass();
+		sub.reset();
+		Context* worker = ctx.thread_subtest("worker");
+		worker->fail();
+		ctx.merge();
+		ctx.BAIL("crash");
+	}
+	{
+		std::stringstream out;
+		Context ctx(out);
+		ctx.journal(path, true);
+		std::unique_ptr<Context> sub(ctx.subtest(odd));
+		ok(sub->resumed(), "escaped descriptions are replayed");
+		sub.reset();
+		Context* worker = ctx.thread_subtest("worker");
+		ok(worker->resumed() and not worker->summary(), "thread subtests are journaled");
+		ctx.merge();
+		like(out.str(), "[\\s\\S]*\n    # resumed from journal\nnot ok 2 - worker\n",
+			"and replayed when merged");
+	}
+
+	/* Dependency skips are journaled like other subtests, so that
+	 * resuming with run or run_parallel replays them */
+	unlink(path.c_str());
+	Suite deps;
+	int bodies = 0;
+	deps.add("broken", [&] (Context& t) { ++bodies; t.fail("always"); });
+	deps.add("needs broken", {"broken"}, [&] (Context& t) { ++bodies; t.pass(); });
+	deps.add("after", [&] (Context& t) { ++bodies; t.pass("runs"); });
+	{
+		std::stringstream out;
+		Context ctx(out);
+		ctx.journal(path);
+		deps.run(ctx, {"needs broken"});
+		ctx.BAIL("crash");
+	}
+	std::ifstream skips(path);
+	std::string skipped((std::istreambuf_iterator<char>(skips)), std::istreambuf_iterator<char>());
+	is(skipped, std::string("not ok\tbroken\nok\tneeds broken\n"), "dependency skips are journaled");
+
+	for (bool parallel : { false, true }) {
+		std::ofstream(path) << skipped;
+		bodies = 0;
+		std::stringstream out;
+		{
+			Context ctx(out);
+			ctx.journal(path, true);
+			if (parallel)
+				deps.run_parallel(ctx, 2);
+			else
+				deps.run(ctx);
+		}
+		std::string text = out.str();
+		ok(bodies == 1 and text.find("needs broken") == text.rfind("needs broken") and
+			std::regex_match(text, std::regex("[\\s\\S]*\nnot ok 1 - broken\n[\\s\\S]*\nok 2 - needs broken\n"
+			    "[\\s\\S]*\nok 3 - after\n1..3\n")),
+			std::string("resuming ") + (parallel ? "run_parallel" : "run") + " with a failed dependency");
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#include <tappp.hpp>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(7);
+
+	Bench::Load load;
+	load.rate    = 2000;
+	load.length  = 200ms;
+	load.workers = 2;
+
+	auto fast = Bench::load(load, [] { });
+	/* The schedule is fixed in advance in whole nanoseconds, so this
+	 * depends neither on timing nor on floating-point rounding */
+	is(fast.calls, std::uint64_t(400), "calls issued at the arrival rate");
+	ok(fast.offered() == 2000 and fast.throughput() > 0, "offered and achieved throughput");
+	latency(fast, 0.50, 50ms, "no-op handler is fast");
+
+	/* A handler which stalls once for longer than the whole run:
+	 * the calls scheduled during the stall must be charged for it. */
+	std::atomic<bool> stalled{false};
+	load.workers = 1;
+	auto stall = Bench::load(load, [&] {
+		if (not stalled.exchange(true))
+			std::this_thread::sleep_for(100ms);
+	});
+	ok(stall.service.percentile(0.5) < 1000000, "service time is mostly short");
+	ok(stall.latency.percentile(0.75) > 20000000, "latency includes the stall");
+
+	load.arrivals = Bench::Arrivals::Poisson;
+	load.workers  = 2;
+	load.seed     = 42;
+	auto poisson = Bench::load(load, [] { throw 1; });
+	is(poisson.errors, poisson.calls, "errors are counted");
+
+	load.rate = 0;
+	throws<std::invalid_argument>([&] { Bench::load(load, [] { }); }, "rate must be positive");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(6);
+
+	std::atomic<unsigned int> cores{0}, peak{0};
+	std::atomic<int> port_users{0};
+	bool port_shared = false;
+
+	/* Occupy `n` cores for a while and record the peak usage. */
+	auto occupy = [&] (unsigned int n, bool port) {
+		return [&, n, port] (Context& t) {
+			unsigned int now = cores += n;
+			for (unsigned int p = peak; now > p and not peak.compare_exchange_weak(p, now); )
+				;
+			if (port and ++port_users > 1)
+				port_shared = true;
+			std::this_thread::sleep_for(20ms);
+			if (port)
+				--port_users;
+			cores -= n;
+			t.pass("done");
+		};
+	};
+
+	Suite suite;
+	suite.add("small 1", occupy(1, false));
+	suite.add("big",     occupy(4, false));
+	suite.add("port 1",  occupy(1, true));
+	suite.add("port 2",  occupy(1, true));
+	suite.add("huge",    occupy(8, false));
+	suite.add("small 2", occupy(1, false));
+	suite.needs("big",    {4, 0, {}, 3})
+	     .needs("port 1", {1, 0, {"port range"}, 0})
+	     .needs("port 2", {1, 0, {"port range"}, 0})
+	     .needs("huge",   {8, 0, {}, 0});
+
+	std::stringstream out, trace;
+	{
+		Context ctx(out);
+		suite.capacity({4, 0, {}, 0}).trace(&trace);
+		suite.run_parallel(ctx, 4);
+	}
+
+	like(out.str(), "[\\s\\S]*\nok 6 - small 2\n1..6\n", "all subtests ran");
+	is(peak.load(), 8U, "the oversized subtest runs alone");
+	ok(not port_shared, "exclusive resources are not shared");
+
+	auto log = trace.str();
+	like(log, "[0-9.]+s admit 'big' [\\s\\S]*", "longest subtest is admitted first");
+	like(log, "[\\s\\S]*s defer 'port 2' \\(cores 1, [0-9]+/4 used; exclusive port range\\)\n[\\s\\S]*",
+		"deferrals are traced");
+
+	throws<std::invalid_argument>([&] { suite.needs("nope", {}); }, "needs checks the name");
+
+	return EXIT_SUCCESS;
+}
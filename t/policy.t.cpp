@@ -0,0 +1,72 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace TAP::Policy;
+
+/* Counts how often it is stringified */
+struct Loud { int v; };
+static int printed = 0;
+std::ostream& operator<<(std::ostream& os, const Loud& l) { ++printed; return os << l.v; }
+bool operator==(const Loud& a, const Loud& b) { return a.v == b.v; }
+
+int main(void) {
+	plan(7);
+
+	std::stringstream full;
+	{
+		BasicContext<Buffered, SingleThreaded, Full> ctx(full);
+		ctx.TODO("later");
+		ctx.is(1, 2, "differs");
+		ctx.note("noted");
+		ctx.subtest("inner", [] (auto& t) { t.pass("deep"); });
+	}
+	is(full.str(), "not ok 1 - differs # TODO later\n# Expected: '2'\n#      Got: '1'\n# noted\n"
+		"    ok 1 - deep\n    1..1\nok 2 - inner\n1..2\n", "buffered single-threaded context");
+
+	std::stringstream tap;
+	{
+		BasicContext<Unbuffered, Threaded, TapOnly> ctx(tap);
+		ctx.is(1, 2, "differs");
+		ctx.diag("dropped");
+		ctx.SKIP(2, "elsewhere");
+	}
+	is(tap.str(), "not ok 1 - differs\nok 2 - # SKIP elsewhere 1/2\nok 3 - # SKIP elsewhere 2/2\n1..3\n",
+		"TAP-only context drops comments");
+
+	{
+		std::stringstream dropped;
+		BasicContext<Buffered, SingleThreaded, TapOnly> ctx(dropped);
+		ctx.is(Loud{1}, Loud{2}, "differs");
+		ctx.isnt(Loud{1}, Loud{1}, "same");
+	}
+	is(printed, 0, "TAP-only context does not stringify diagnostics");
+
+	std::stringstream quiet;
+	bool good;
+	unsigned int run;
+	{
+		BasicContext<Quiet, SingleThreaded, TapOnly> ctx(quiet);
+		ctx.plan(4);
+		ctx.TODO(2, "later");
+		ctx.fail("one");
+		ctx.fail("two");
+		ctx.SKIP(2);
+		ctx.diag("nothing");
+		good = ctx.summary();
+		run = ctx.stats().run;
+	}
+	is(quiet.str(), "", "quiet context writes nothing");
+	ok(good, "but keeps count");
+	is(run, 4U, "of all tests");
+
+	std::stringstream bail;
+	{
+		BasicContext<Quiet, Threaded, Full> ctx(bail);
+		ctx.BAIL("stop");
+	}
+	is(bail.str(), "Bail out! stop\n", "except bailing out");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(10);
+
+	std::stringstream out;
+	Context ctx(out);
+	ctx.plan(10);
+	ctx.pass("one");
+	ctx.TODO("later");
+	ctx.fail("two");
+	ctx.fail("three");
+	ctx.SKIP(2, "elsewhere");
+	ctx.subtest("four", [] (Context& t) {
+		t.pass("a");
+		t.pass("b");
+	});
+
+	auto st = ctx.stats();
+	is(st.planned, 10U, "planned");
+	is(st.run, 6U, "run");
+	is(st.passed, 4U, "passed");
+	is(st.failed, 2U, "failed");
+	is(st.todo, 1U, "failed TODO");
+	is(st.skipped, 2U, "skipped");
+	is(st.assertions, std::uint64_t(8), "assertions in subtests count");
+
+	/* Read the counters from another thread while tests are running */
+	std::atomic<bool> stop{false};
+	unsigned int seen = 0;
+	std::thread reader([&] {
+		while (not stop)
+			seen = std::max(seen, ctx.stats().run);
+	});
+	std::stringstream many;
+	{
+		Context inner(many);
+		for (int i = 0; i < 10000; ++i)
+			inner.pass();
+	}
+	for (int i = 0; i < 4; ++i)
+		ctx.pass("more");
+	stop = true;
+	reader.join();
+	ok(seen <= 10, "consistent snapshots from another thread");
+
+	/* Every third test fails. No snapshot may count more tests as
+	 * passed or failed than were run, nor show a phantom failure. */
+	std::atomic<bool> writing{true};
+	unsigned int torn = 0;
+	std::thread checker;
+	{
+		BasicContext<Policy::Quiet, Policy::Threaded, Policy::TapOnly> busy(many);
+		checker = std::thread([&] {
+			while (writing) {
+				auto s = busy.stats();
+				if (s.passed + s.failed > s.run or s.failed > (s.run + 2) / 3)
+					++torn;
+			}
+		});
+		for (int i = 0; i < 200000; ++i)
+			busy.ok(i % 3 != 0);
+		writing = false;
+		checker.join();
+	}
+	is(torn, 0U, "passed + failed <= run under contention");
+
+	std::string status = "/tmp/tappp-progress-" + std::to_string(::getpid());
+	{
+		std::stringstream sink;
+		Context slow(sink);
+		slow.plan(4);
+		slow.heartbeat(20ms, status);
+		slow.pass("first");
+		std::this_thread::sleep_for(100ms);
+		std::ifstream in(status);
+		std::string line;
+		std::getline(in, line);
+		like(line, "# progress: 1/4 tests, 0 failed, 0 skipped, 1 assertions at [0-9.]+/s, [0-9.]+s elapsed, ETA [0-9.]+s",
+			"heartbeat writes status file");
+		slow.SKIP(3);
+	}
+	std::remove(status.c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace TAP;
+
+int main(void) {
+	plan(6);
+
+	std::stringstream out;
+	{
+		Context ctx(out);
+		ctx.pass("first");
+		ctx.SKIP(3, "not here");
+		ctx.SKIP(2);
+		ctx.subtest("inner", [] (Context& t) {
+			t.SKIP(1, "deep");
+		});
+	}
+	is(out.str(), "ok 1 - first\n"
+		"ok 2 - # SKIP not here 1/3\nok 3 - # SKIP not here 2/3\nok 4 - # SKIP not here 3/3\n"
+		"ok 5 - # SKIP 1/2\nok 6 - # SKIP 2/2\n"
+		"    ok 1 - # SKIP deep 1/1\n    1..1\nok 7 - inner\n1..7\n",
+		"skip lines with counters");
+
+	std::stringstream todo;
+	bool is_ok;
+	{
+		Context ctx(todo);
+		ctx.TODO(3, "later");
+		ctx.fail("one");
+		ctx.SKIP(1, "two");
+		ctx.pass("three");
+		ctx.fail("four");
+		is_ok = ctx.summary();
+	}
+	is(todo.str(), "not ok 1 - one # TODO later\nok 2 - # SKIP two 1/1 # TODO later\n"
+		"ok 3 - three # TODO later\nnot ok 4 - four\n1..4\n",
+		"TODO range covers the next three tests");
+	nok(is_ok, "test after the range counts");
+
+	std::stringstream many;
+	{
+		Context ctx(many);
+		ctx.SKIP(100000, "platform");
+		is_ok = ctx.summary();
+	}
+	std::string tap = many.str();
+	ok(is_ok, "skipped tests pass");
+	is(std::count(tap.begin(), tap.end(), '\n'), 100001, "all skip lines written");
+	std::string last = "\nok 100000 - # SKIP platform 100000/100000\n1..100000\n";
+	ok(tap.find("\nok 9999 - # SKIP platform 9999/100000\nok 10000 - # SKIP platform 10000/100000\n") != std::string::npos and
+		tap.compare(tap.size() - last.size(), last.size(), last) == 0,
+		"counters carry over");
+
+	return EXIT_SUCCESS;
+}
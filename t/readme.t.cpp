@@ -45,7 +45,7 @@ int main(void) {
 		}, "resizing too much leaves domain");
 
 		done_testing();
-	}
+	};
 
 	b[2] = a[2] = b[2] * 2;
 	is(b[2], 30, "changed last element");
@@ -0,0 +1,60 @@
+#include <tappp.hpp>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+using namespace TAP;
+
+int main(void) {
+	plan(10);
+
+	int reached = 0;
+	TODO("fixture is missing");
+	subtest(4, "precondition fails", [&] {
+		std::vector<int> fixture;
+		require_is(fixture.size(), 3U, "fixture loaded");
+		++reached;
+		is(fixture.at(2), 5, "never runs");
+	});
+	is(reached, 0, "rest of the subtest was not run");
+
+	subtest("precondition holds", [&] {
+		require(1 + 1 == 2, "arithmetic");
+		++reached;
+		pass("after require");
+	});
+	is(reached, 1, "rest of the subtest was run");
+
+	/* A SUBTEST block catches a failed require like a functional
+	 * subtest: only the innermost block is left */
+	SUBTEST(2, "outer block") {
+		TODO("inner block requires");
+		SUBTEST(2, "inner block") {
+			require(false, "needed");
+			++reached;
+		};
+		++reached;
+		pass("outer block carries on");
+	};
+	is(reached, 2, "only the inner block is left");
+
+	TODO("required at the top level");
+	SUBTEST(2, "top-level block") {
+		require(false, "needed");
+		++reached;
+	};
+	is(reached, 2, "top-level block is left without terminating");
+
+	Suite suite;
+	suite.add("required", [&] (Context& t) {
+		t.plan(3);
+		t.require(false, "needed");
+		t.pass("never runs");
+	});
+	TODO("suite subtest fails");
+	suite.run(*TAPP);
+
+	ok(true, "parent carries on");
+
+	return EXIT_SUCCESS;
+}
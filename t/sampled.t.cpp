@@ -0,0 +1,78 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace TAP;
+
+static std::vector<int> picks(Context& ctx, double rate, std::uint64_t seed, int n) {
+	std::vector<int> ret;
+	auto every = ctx.sampled(rate, seed);
+	for (int i = 0; i < n; ++i) {
+		if (every())
+			ret.push_back(i);
+	}
+	return ret;
+}
+
+int main(void) {
+	plan(14);
+
+	::unsetenv("TAPPP_TIER");
+	std::stringstream out;
+	{
+		Context ctx(out);
+		auto a = picks(ctx, 0.1, 42, 10000);
+		auto b = picks(ctx, 0.1, 42, 10000);
+		auto c = picks(ctx, 0.1, 7, 10000);
+		ok(a == b, "same seed, same sample");
+		ok(a != c, "other seed, other sample");
+		ok(a.size() > 850 and a.size() < 1150, "sample size close to rate");
+		is(picks(ctx, 0, 1, 100).size(), 0UL, "rate 0 samples nothing");
+		is(picks(ctx, 1, 1, 100).size(), 100UL, "rate 1 samples everything");
+		auto s = ctx.sampled(0.5, 3);
+		ok(s.contains(17) == ctx.sampled(0.5, 3).contains(17), "membership is a function of the index");
+	}
+	like(out.str(), "# sampled [0-9]+ of 10000 iterations at rate 0.1, seed 42\n[\\s\\S]*", "rate and seed noted");
+
+	std::stringstream rejected;
+	throws<std::invalid_argument>([&] {
+		Context ctx(rejected);
+		ctx.sampled(std::numeric_limits<double>::quiet_NaN());
+	}, "NaN rate is rejected");
+	throws<std::invalid_argument>([&] {
+		Context ctx(rejected);
+		ctx.sampled(std::numeric_limits<double>::infinity());
+	}, "infinite rate is rejected");
+
+	::setenv("TAPPP_TIER", "exhaustive", 1);
+	{
+		Context ctx(out);
+		is(picks(ctx, 0.01, 42, 1000).size(), 1000UL, "exhaustive tier samples everything");
+	}
+
+	::setenv("TAPPP_TIER", "smoke", 1);
+	std::stringstream smoke;
+	{
+		Context ctx(smoke);
+		if (ctx.within_tier(Tier::smoke))
+			ctx.pass("cheap");
+		if (ctx.within_tier(Tier::full, 2)) {
+			ctx.fail("expensive");
+			ctx.fail("expensive");
+		}
+		ok(Context::tier() == Tier::smoke, "tier from the environment");
+		auto few = picks(ctx, 0.1, 42, 10000);
+		ok(few.size() > 70 and few.size() < 130, "smoke tier samples a tenth of the rate");
+		is(picks(ctx, 1, 42, 100).size(), 100UL, "but rate 1 still samples everything");
+	}
+	like(smoke.str(), "ok 1 - cheap\nok 2 - # SKIP full tier 1/2\nok 3 - # SKIP full tier 2/2\n"
+		"# sampled [0-9]+ of 10000 iterations at rate 0.01, seed 42\n[\\s\\S]*1..3\n",
+		"costly tests skipped below their tier");
+	::unsetenv("TAPPP_TIER");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+using namespace TAP;
+using namespace std::chrono_literals;
+
+int main(void) {
+	plan(3);
+
+	std::stringstream out;
+	{
+		Context ctx(out);
+		ctx.slowest(2);
+		for (int ms : { 1, 30, 2, 15, 3 }) {
+			std::unique_ptr<Context> sub(ctx.subtest("sleep " + std::to_string(ms)));
+			std::this_thread::sleep_for(ms * 1ms);
+			sub->pass();
+		}
+		Context* worker = ctx.thread_subtest("worker");
+		std::thread([&] {
+			worker->pass();
+			std::this_thread::sleep_for(20ms);
+			worker->done_testing();
+		}).join();
+	}
+
+	like(out.str(), "[\\s\\S]*# slowest 2 subtests:\n"
+		"#   0.0[0-9]+s +[0-9.]+%  sleep 30\n"
+		"#   0.0[0-9]+s +[0-9.]+%  worker \\(cpu 0.0[0-9]+s\\)\n1..6\n",
+		"two slowest subtests are reported in order");
+
+	std::stringstream quiet;
+	{
+		Context ctx(quiet);
+		std::unique_ptr<Context> sub(ctx.subtest("untracked"));
+		sub->pass();
+	}
+	unlike(quiet.str(), "[\\s\\S]*slowest[\\s\\S]*", "report is off by default");
+
+	std::stringstream nested;
+	{
+		Context ctx(nested);
+		ctx.slowest(10);
+		std::unique_ptr<Context> outer(ctx.subtest("outer"));
+		std::unique_ptr<Context> inner(outer->subtest("inner"));
+		inner->pass();
+		inner->done_testing();
+		outer->done_testing();
+	}
+	like(nested.str(), "[\\s\\S]*  outer / inner\n[\\s\\S]*", "nested subtests report their path");
+
+	return EXIT_SUCCESS;
+}
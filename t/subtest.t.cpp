@@ -19,7 +19,7 @@ int main(void) {
 		is("55", 55, "incompatible types but fitting matcher",
 				[&](std::string s, int i) { return s == std::to_string(i); });
 		SKIP("can't think of anything");
-	}
+	};
 
 	pass("relaxing in between");
 
@@ -31,7 +31,7 @@ int main(void) {
 		SUBTEST(2, "subtests are nestable") {
 			lives([&] { std::sqrt( 2); }, "sqrt( 2) lives");
 			lives([&] { std::sqrt(-2); }, "sqrt(-2) lives, too");
-		}
+		};
 
 		TODO("research correct exception type");
 		throws<std::domain_error>([&] {
@@ -40,7 +40,7 @@ int main(void) {
 		}, "resizing too much leaves domain");
 
 		done_testing();
-	}
+	};
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,115 @@
+#include <tappp.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace TAP;
+
+/* Remembers how much had been written at every flush, and when */
+struct Arrivals : std::stringbuf {
+	std::vector<std::pair<std::chrono::steady_clock::time_point, std::size_t>> flushes;
+	int sync(void) override {
+		flushes.push_back({ std::chrono::steady_clock::now(), str().size() });
+		return 0;
+	}
+};
+
+int main(void) {
+	plan(12);
+
+	static int setups = 0;
+	static std::vector<int> table;
+	Suite suite;
+	suite.setup([&] { ++setups; table.assign(1000, 7); });
+	suite.add("lookup", [&] (Context& t) {
+		t.is(table.size(), 1000U, "table is set up");
+		t.is(table[500], 7, "table has entries");
+	});
+	suite.add("throws", [&] (Context& t) {
+		t.pass("before");
+		throw std::runtime_error("boom");
+	});
+	suite.add("slow", [&] (Context& t) {
+		t.pass("before the nap");
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		t.pass("after the nap");
+	});
+
+	std::stringstream out;
+	{
+		Context ctx(out);
+		suite.run(ctx, {"lookup", "nope"});
+	}
+	like(out.str(), "[\\s\\S]*\nok 1 - lookup\nnot ok 2 - no such subtest: nope\n1..2\n",
+		"subtests are selected by name");
+
+	std::stringstream thrown;
+	{
+		Context ctx(thrown);
+		suite.run(ctx, {"throws"});
+	}
+	like(thrown.str(), "[\\s\\S]*    not ok 2 - uncaught exception\n    # boom\n[\\s\\S]*not ok 1 - throws\n1..1\n",
+		"exceptions fail the subtest");
+	is(setups, 1, "fixtures are set up once");
+
+	std::string path = "/tmp/tappp-suite-" + std::to_string(getpid());
+	pid_t server = fork();
+	if (server == 0) {
+		suite.serve(path);
+		_exit(0);
+	}
+
+	std::stringstream served, listed;
+	Suite::request(path, "run", {"lookup"}, served);
+	like(served.str(), "[\\s\\S]*\nok 1 - lookup\n1..1\n", "server runs subtests");
+	Suite::request(path, "list", {}, listed);
+	is(listed.str(), std::string("lookup\nthrows\nslow\n"), "server lists subtests");
+
+	auto client = [&] (std::vector<std::string> args, std::ostream& out, std::string mode = "--client") {
+		args.insert(args.begin(), {"suite.t", mode, path});
+		std::vector<char*> argv;
+		for (auto& a : args)
+			argv.push_back(&a[0]);
+		Context ctx(out);
+		return suite.main(ctx, argv.size(), argv.data());
+	};
+	std::stringstream relayed, failed;
+	int good = client({"lookup"}, relayed);
+	int bad = client({"throws"}, failed);
+	ok(good == EXIT_SUCCESS and relayed.str().find("1..0") == std::string::npos and
+		relayed.str().substr(relayed.str().size() - 5) == "1..1\n", "client relays one plan");
+	is(bad, EXIT_FAILURE, "client exit status reflects relayed failures");
+
+	Arrivals arrivals;
+	std::ostream streamed(&arrivals);
+	int slow = client({"slow"}, streamed);
+	auto done = std::chrono::steady_clock::now();
+	bool early = false;
+	for (const auto& [when, size] : arrivals.flushes) {
+		if (arrivals.str().substr(0, size).find("before the nap") != std::string::npos)
+			early = early or done - when >= std::chrono::milliseconds(200);
+	}
+	ok(slow == EXIT_SUCCESS and early, "client relays results as they arrive");
+
+	std::stringstream usage;
+	{
+		std::string prog = "suite.t", serve = "--serve";
+		char* argv[] = { &prog[0], &serve[0] };
+		Context ctx(usage);
+		is(suite.main(ctx, 2, argv), EXIT_FAILURE, "--serve without PATH is a usage error");
+	}
+
+	std::stringstream bye;
+	is(client({}, bye, "--quit"), EXIT_SUCCESS, "client stops the server");
+	is(bye.str(), "1..0 # SKIP server stopped\n", "and prints a TAP document");
+	int status;
+	waitpid(server, &status, 0);
+	ok(WIFEXITED(status) and access(path.c_str(), F_OK) != 0, "server quits and removes its socket");
+
+	return EXIT_SUCCESS;
+}
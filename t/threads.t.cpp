@@ -0,0 +1,35 @@
+#include <tappp.hpp>
+#include <vector>
+#include <thread>
+#include <string>
+#include <cstdlib>
+
+using namespace TAP;
+
+int main(void) {
+	plan(4);
+
+	const unsigned int workers = 4;
+	std::vector<Context*> subs;
+	for (unsigned int w = 0; w < workers; ++w)
+		subs.push_back(thread_subtest("worker " + std::to_string(w)));
+
+	std::vector<std::thread> pool;
+	for (unsigned int w = 0; w < workers; ++w) {
+		pool.emplace_back([&, w] {
+			Context& t = *subs[w];
+			unsigned long sum = 0;
+			for (unsigned long i = w; i < 10000; i += workers) {
+				sum += i;
+				t.ok(i % workers == w, "stride");
+			}
+			t.ok(sum > 0, "summed something");
+			t.done_testing();
+		});
+	}
+	for (auto& th : pool)
+		th.join();
+	merge();
+
+	return EXIT_SUCCESS;
+}
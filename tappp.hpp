@@ -22,6 +22,57 @@
 #include <exception>
 #include <functional>
 #include <type_traits>
+#include <chrono>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <random>
+#include <atomic>
+#include <typeinfo>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <system_error>
+#include <cerrno>
+#include <string_view>
+#include <deque>
+#include <condition_variable>
+#include <stdexcept>
+#include <filesystem>
+#include <cstdio>
+
+/* Some features need an operating system that is at least POSIX-ish */
+#if __has_include(<unistd.h>)
+# define TAPPP_POSIX 1
+# include <unistd.h>
+# include <sys/resource.h>
+# include <sys/time.h>
+# include <fcntl.h>
+# include <time.h>
+# include <signal.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include <poll.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# ifdef __linux__
+#  include <sched.h>
+# endif
+#endif
+
+/* Build with --coverage -DTAPPP_COVERAGE to record coverage maps */
+#if defined(TAPPP_POSIX) && defined(TAPPP_COVERAGE)
+extern "C" void __gcov_reset(void);
+extern "C" void __gcov_dump(void);
+#endif
 
 #define TAPPP_VERSION	0x000200U
 
@@ -55,6 +106,16 @@ namespace TAP {
 		struct LatePlan : std::runtime_error {
 			LatePlan(void) : std::runtime_error("Too late to plan tests now") { }
 		};
+
+		/**
+		 * Thrown by `require` and its variants when the assertion fails.
+		 * It unwinds the current subtest and is caught by the subtest
+		 * scope, so that the parent can carry on.
+		 */
+		struct Required : std::runtime_error {
+			Required(const std::string& message) :
+				std::runtime_error("Required test failed: " + message) { }
+		};
 	}
 
 	/* Misc tools */
@@ -110,9 +171,9 @@ namespace TAP {
 		 * Print a variadic sequence of stringifiable things.
 		 */
 		template <typename T, typename... Rs>
-		std::ostream& print(std::ostream& out, T x, Rs... rest) {
+		std::ostream& print(std::ostream& out, T&& x, Rs&&... rest) {
 			static_assert(Occult::Stringifiable<T>::value);
-			return print(out << x, rest...);
+			return print(out << std::forward<T>(x), std::forward<Rs>(rest)...);
 		}
 
 		/**
@@ -132,431 +193,4781 @@ namespace TAP {
 			}
 		};
 
-	}
-
-	/**
-	 * A sentinel type accepted by the Context constructor to indicate
-	 * that all tests should be skipped.
-	 */
-	enum skip_all { SKIP_ALL };
-
-	/**
-	 * A Context holds a TAP producer's state, including the test
-	 * plan, the test numbering, output stream and TODO directives.
-	 * Its methods update the state and print TAP directly to the
-	 * output device.
-	 */
-	class Context {
-		std::ostream& out = std::cout;  /**< Output device     */
-		unsigned int planned = 0; /**< Number of planned tests */
-		unsigned int run     = 0; /**< Number of run tests     */
-		unsigned int good    = 0; /**< Number of "ok" tests    */
-		unsigned int todos   = 0; /**< Number of failed TODOs  */
-		std::string  todo   = ""; /**< Next test's TODO        */
+#ifdef __linux__
+		/**
+		 * The CPU quota of the cgroup (v2) of this process and all of
+		 * its ancestors, rounded up to whole CPUs, or zero if there is
+		 * no limit. The cgroup is looked up in the file `self` and the
+		 * quota is read from the `cpu.max` files below `root`.
+		 */
+		static unsigned int cgroup_cpus(const std::string& self_path = "/proc/self/cgroup",
+		    const std::string& root = "/sys/fs/cgroup") {
+			std::ifstream self(self_path);
+			std::string path;
+			for (std::string line; std::getline(self, line); ) {
+				if (line.compare(0, 3, "0::") == 0)
+					path = line.substr(3);
+			}
+			if (path.empty())
+				return 0;
 
-		bool have_plan = false; /**< Whether a plan line was printed */
-		bool finished  = false; /**< Whether done_testing was called */
+			unsigned int cpus = 0;
+			for (;;) {
+				std::ifstream max(root + path + "/cpu.max");
+				std::string quota;
+				double period;
+				if (max >> quota >> period and quota != "max" and period > 0) {
+					auto n = static_cast<unsigned int>(std::ceil(std::stod(quota) / period));
+					n = std::max(n, 1U);
+					cpus = cpus ? std::min(cpus, n) : n;
+				}
+				if (path.empty() or path == "/")
+					break;
+				path.erase(path.rfind('/'));
+			}
+			return cpus;
+		}
+#endif
 
-		unsigned int depth       = 0; /**< Subtest depth       */
-		std::string description = ""; /**< Subtest description */
-		Context* parent = nullptr;    /**< Parent in the subtest stack */
+		/**
+		 * Number of CPUs this process may use. On Linux, that is bounded
+		 * by the affinity mask of the calling thread and the CPU quota of
+		 * the cgroup, so that tests in a container do not size themselves
+		 * after the host.
+		 */
+		static unsigned int cpu_count(void) {
+			unsigned int n = std::thread::hardware_concurrency();
+#ifdef __linux__
+			cpu_set_t set;
+			if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+				n = CPU_COUNT(&set);
+			if (unsigned int quota = cgroup_cpus())
+				n = std::min(n, quota);
+#endif
+			return n ? n : 1;
+		}
 
 		/**
-		 * Return `out` but apply `depth` indentation first.
+		 * Number of threads to use for parallel work: the value of the
+		 * environment variable TAPPP_JOBS, which is clamped to `cpu_count`,
+		 * or else `cpu_count` itself.
 		 */
-		std::ostream& line(void) {
-			return out << std::string(4 * depth, ' ');
+		static unsigned int jobs(void) {
+			unsigned int n = cpu_count();
+			if (const char* env = std::getenv("TAPPP_JOBS")) {
+				unsigned long want = std::strtoul(env, nullptr, 10);
+				if (want > 0 and want < n)
+					return want;
+			}
+			return n;
 		}
 
-	public:
+		/**
+		 * The outcome of calling a function: either a value or the
+		 * description of an exception it threw.
+		 */
+		template<typename R>
+		struct Outcome {
+			std::unique_ptr<R> value;
+			std::string exception;
+
+			template<typename F, typename... Args>
+			void capture(F& f, const Args&... args) {
+				try {
+					value = std::make_unique<R>(f(args...));
+				}
+				catch (const std::exception& e) {
+					exception = std::string(typeid(e).name()) + ": " + e.what();
+				}
+				catch (...) {
+					exception = "unknown exception";
+				}
+			}
+
+			std::string describe(void) const {
+				if (not value)
+					return "threw " + exception;
+				if constexpr (Occult::Stringifiable<R>::value)
+					return "'" + to_string(*value) + "'";
+				else
+					return "(not stringifiable)";
+			}
+		};
 
 		/**
-		 * Create a new empty Context object. The default output device
-		 * is std::cout. No plan line is printed. You either have to call
-		 * `plan` before any tests or `done_testing` after the last one.
+		 * Whether every byte of a T belongs to its value, so that equal
+		 * values have equal bytes, except for the signed zeros and NaNs
+		 * of float and double. Padding bytes are indeterminate.
 		 */
-		Context(std::ostream& out = std::cout) : out(out) { }
+		template<typename T>
+		struct NoPadding : std::bool_constant<std::has_unique_object_representations_v<T> or
+		    std::is_same_v<T, float> or std::is_same_v<T, double>> { };
+
+		template<typename T, std::size_t N>
+		struct NoPadding<T[N]> : NoPadding<T> { };
+
+		template<typename T, std::size_t N>
+		struct NoPadding<std::array<T, N>> :
+		    std::bool_constant<NoPadding<T>::value and sizeof(std::array<T, N>) == N * sizeof(T)> { };
 
 		/**
-		 * Create a new Context object and print a plan line.
+		 * View the object representation of a value as bytes: either
+		 * the value itself if it is trivially copyable or the elements
+		 * of a contiguous container of trivially copyable elements.
+		 * Types with padding are rejected.
 		 */
-		Context(unsigned int tests, std::ostream& out = std::cout) : out(out) {
-			plan(tests);
+		template<typename T>
+		static std::pair<const unsigned char*, std::size_t> bytes_of(const T& x) {
+			if constexpr (std::is_trivially_copyable_v<T>) {
+				static_assert(NoPadding<T>::value,
+				    "the value must not have padding bytes, whose contents are indeterminate");
+				return { reinterpret_cast<const unsigned char*>(&x), sizeof(x) };
+			}
+			else {
+				using E = std::remove_cv_t<std::remove_reference_t<decltype(*std::data(x))>>;
+				static_assert(std::is_trivially_copyable_v<E>,
+				    "elements of the container must be trivially copyable");
+				static_assert(NoPadding<E>::value,
+				    "elements of the container must not have padding bytes, whose contents are indeterminate");
+				return { reinterpret_cast<const unsigned char*>(std::data(x)),
+				         std::size(x) * sizeof(E) };
+			}
 		}
 
 		/**
-		 * Create a new Context and skip it entirely. The `1..0` plan
-		 * line is printed and the context is marked as finished.
+		 * The SplitMix64 finalizer, which scrambles consecutive integers
+		 * into well-distributed 64-bit values.
 		 */
-		Context(const skip_all& skip [[maybe_unused]], const std::string& reason = "", std::ostream& out = std::cout) : out(out) {
-			plan(skip, reason);
+		static std::uint64_t mix64(std::uint64_t x) {
+			x += 0x9E3779B97F4A7C15ULL;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+			return x ^ (x >> 31);
 		}
 
 		/**
-		 * Unless already done, close this TAP session.
+		 * A fast, non-cryptographic 64-bit hash of a byte string.
+		 * It consumes eight bytes at a time.
 		 */
-		~Context(void) {
-			if (not finished)
-				done_testing();
+		static std::uint64_t hash_bytes(const unsigned char* p, std::size_t n) {
+			const std::uint64_t k = 0x9E3779B97F4A7C15ULL;
+			std::uint64_t h = n * k;
+			auto mix = [&] (std::uint64_t w) {
+				h = (h ^ w) * k;
+				h ^= h >> 29;
+			};
+			std::size_t i = 0;
+			for (; i + 8 <= n; i += 8) {
+				std::uint64_t w;
+				std::memcpy(&w, p + i, 8);
+				mix(w);
+			}
+			if (i < n) {
+				std::uint64_t w = 0;
+				std::memcpy(&w, p + i, n - i);
+				mix(w);
+			}
+			h ^= h >> 32;
+			h *= 0xD6E8FEB86659FD93ULL;
+			h ^= h >> 32;
+			return h;
 		}
 
+#ifdef TAPPP_POSIX
 		/**
-		 * Create a new subtest off this one. The subtest uses the
-		 * same output device but indents its output, so that subtest-
-		 * unaware harnesses ignore it. When the subtest is destroyed,
-		 * it adds a single summary `pass` or `fail` to the test it
-		 * was created from. The user is responsible for keeping the
-		 * parent context alive.
+		 * Stream buffer writing to a file descriptor.
 		 */
-		Context* subtest(const std::string& message = "") {
-			auto sub = std::make_unique<Context>(out);
-			sub->depth = depth + 1;
-			sub->description = message;
-			sub->parent = this;
-			return sub.release();
-		}
+		class FdBuf : public std::streambuf {
+			int fd;
+			char buf[4096];
+
+		public:
+			FdBuf(int fd) : fd(fd) {
+				setp(buf, buf + sizeof(buf));
+			}
+
+			~FdBuf(void) {
+				sync();
+			}
+
+		protected:
+			int overflow(int c) override {
+				if (sync() < 0)
+					return traits_type::eof();
+				if (c != traits_type::eof()) {
+					*pptr() = c;
+					pbump(1);
+				}
+				return traits_type::not_eof(c);
+			}
+
+			int sync(void) override {
+				for (char* p = pbase(); p < pptr(); ) {
+					ssize_t n = ::write(fd, p, pptr() - p);
+					if (n < 0) {
+						if (errno == EINTR)
+							continue;
+						return -1;
+					}
+					p += n;
+				}
+				setp(buf, buf + sizeof(buf));
+				return 0;
+			}
+		};
 
 		/**
-		 * Like `subtest(message)` but already print a plan line.
+		 * Read everything from a file descriptor until end of file.
 		 */
-		Context* subtest(unsigned int tests, const std::string& message = "") {
-			auto sub = std::make_unique<Context>(out);
-			sub->depth = depth + 1;
-			sub->description = message;
-			sub->parent = this;
-			sub->plan(tests);
-			return sub.release();
+		static std::string slurp(int fd) {
+			std::string data;
+			char buf[4096];
+			for (;;) {
+				ssize_t n = ::read(fd, buf, sizeof(buf));
+				if (n < 0 and errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				data.append(buf, n);
+			}
+			return data;
 		}
 
 		/**
-		 * Set up a test plan and emit the plan line.
+		 * Just enough of a JSON reader for the output of gcov. Values
+		 * are read in document order; on malformed input, reading stops
+		 * as if at the end of the document.
 		 */
-		void plan(unsigned int tests) {
-			if (have_plan)
-				throw TAP::X::Planned();
-			if (finished)
-				throw TAP::X::Finished();
+		struct Json {
+			const std::string& s;
+			std::size_t i = 0;
 
-			if (run > 0)
-				throw TAP::X::LatePlan();
+			void space(void) {
+				while (i < s.size() and std::strchr(" \t\r\n", s[i]))
+					++i;
+			}
 
-			line() << "1.." << tests << std::endl;
-			planned = tests;
-			have_plan = true;
-		}
+			bool eat(char c) {
+				space();
+				if (i < s.size() and s[i] == c) {
+					++i;
+					return true;
+				}
+				return false;
+			}
+
+			std::string string(void) {
+				std::string ret;
+				if (not eat('"')) {
+					i = s.size();
+					return ret;
+				}
+				for (; i < s.size() and s[i] != '"'; ++i) {
+					if (s[i] == '\\' and ++i < s.size()) {
+						switch (s[i]) {
+						case 'n': ret += '\n'; break;
+						case 't': ret += '\t'; break;
+						case 'u': ret += '?'; i += 4; break;
+						default:  ret += s[i]; break;
+						}
+					}
+					else
+						ret += s[i];
+				}
+				++i;
+				return ret;
+			}
+
+			std::uint64_t number(void) {
+				space();
+				char* end;
+				auto n = std::strtoull(s.c_str() + std::min(i, s.size()), &end, 10);
+				i = end - s.c_str();
+				return n;
+			}
+
+			/* Call `f` with every key, which must read the value */
+			template<typename F>
+			void object(F f) {
+				if (not eat('{')) {
+					i = s.size();
+					return;
+				}
+				if (eat('}'))
+					return;
+				do {
+					std::string key = string();
+					eat(':');
+					f(key);
+				} while (eat(','));
+				eat('}');
+			}
+
+			/* Call `f` for every element, which must read it */
+			template<typename F>
+			void array(F f) {
+				if (not eat('[')) {
+					i = s.size();
+					return;
+				}
+				if (eat(']'))
+					return;
+				do
+					f();
+				while (eat(','));
+				eat(']');
+			}
+
+			void skip(void) {
+				space();
+				if (i >= s.size())
+					return;
+				if (s[i] == '"')
+					string();
+				else if (s[i] == '{')
+					object([&] (const std::string&) { skip(); });
+				else if (s[i] == '[')
+					array([&] { skip(); });
+				else {
+					while (i < s.size() and not std::strchr(",}] \t\r\n", s[i]))
+						++i;
+				}
+			}
+		};
 
 		/**
-		 * Skip the entire test. Print the `1..0` plan line and then
-		 * mark the context as finished.
+		 * Source files and their executed lines according to the gcov
+		 * data file `gcda`, read with `gcov --json-format`, which needs
+		 * the notes file next to it. Files are named as the compiler saw
+		 * them, relative to its working directory. Files outside of it,
+		 * like the system headers, are left out. Without a gcov program,
+		 * nothing is returned.
 		 */
-		void plan(const skip_all& skip [[maybe_unused]], const std::string& reason = "") {
-			line() << "1..0";
-			if (!reason.empty())
-				out << " # SKIP " << reason;
-			out << std::endl;
-			finished = true;
+		static std::vector<std::pair<std::string, std::vector<unsigned int>>> gcov_lines(const std::string& gcda) {
+			int fds[2];
+			if (::pipe(fds) < 0)
+				return {};
+			pid_t pid = ::fork();
+			if (pid == 0) {
+				::dup2(fds[1], STDOUT_FILENO);
+				int null = ::open("/dev/null", O_WRONLY);
+				if (null >= 0)
+					::dup2(null, STDERR_FILENO);
+				::close(fds[0]);
+				::execlp("gcov", "gcov", "--json-format", "--stdout", gcda.c_str(), static_cast<char*>(nullptr));
+				::_exit(127);
+			}
+			::close(fds[1]);
+			std::string json = pid > 0 ? slurp(fds[0]) : "";
+			::close(fds[0]);
+			while (pid > 0 and ::waitpid(pid, nullptr, 0) < 0 and errno == EINTR)
+				;
+
+			std::string cwd;
+			std::vector<std::pair<std::string, std::vector<unsigned int>>> files;
+			Json in{json};
+			auto line = [&] (std::vector<unsigned int>& lines) {
+				std::uint64_t number = 0, count = 0;
+				in.object([&] (const std::string& key) {
+					if (key == "line_number")
+						number = in.number();
+					else if (key == "count")
+						count = in.number();
+					else
+						in.skip();
+				});
+				if (count > 0)
+					lines.push_back(number);
+			};
+			auto file = [&] (void) {
+				std::string name;
+				std::vector<unsigned int> lines;
+				in.object([&] (const std::string& key) {
+					if (key == "file")
+						name = in.string();
+					else if (key == "lines")
+						in.array([&] { line(lines); });
+					else
+						in.skip();
+				});
+				std::sort(lines.begin(), lines.end());
+				lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+				files.push_back({ name, std::move(lines) });
+			};
+			in.object([&] (const std::string& key) {
+				if (key == "current_working_directory")
+					cwd = in.string();
+				else if (key == "files")
+					in.array(file);
+				else
+					in.skip();
+			});
+
+			namespace fs = std::filesystem;
+			std::vector<std::pair<std::string, std::vector<unsigned int>>> ret;
+			for (auto& [name, lines] : files) {
+				fs::path path(name);
+				if (path.is_absolute())
+					path = path.lexically_relative(cwd);
+				path = path.lexically_normal();
+				if (path.empty() or *path.begin() == "..")
+					continue;
+				ret.push_back({ path.generic_string(), std::move(lines) });
+			}
+			return ret;
 		}
 
 		/**
-		 * Return whether the whole session is good or not, taking into
-		 * account the test plan (if any) and the number of successful
-		 * vs. all run tests.
+		 * Whether the file names `a` and `b` refer to the same file,
+		 * which is assumed if one is a trailing part of the other, so
+		 * that names relative to different directories match.
 		 */
-		bool summary(void) {
-			return good + todos == (have_plan ? planned : run);
+		static bool same_file(const std::string& a, const std::string& b) {
+			namespace fs = std::filesystem;
+			std::string x = fs::path(a).lexically_normal().generic_string();
+			std::string y = fs::path(b).lexically_normal().generic_string();
+			if (x.size() < y.size())
+				std::swap(x, y);
+			if (x.size() == y.size())
+				return x == y;
+			return not y.empty() and x[x.size() - y.size() - 1] == '/' and
+			    x.compare(x.size() - y.size(), std::string::npos, y) == 0;
 		}
+#endif
 
 		/**
-		 * Close this TAP context from emitting further test lines.
-		 * If no test plan was printed in the beginning, it is done now.
+		 * Source of inputs for differential tests: either a generator
+		 * function called with the running index of the input or a
+		 * corpus container which is iterated.
 		 */
-		void done_testing(void) {
-			if (finished)
-				throw TAP::X::Finished();
+		template<typename Gen, bool = std::is_invocable_v<Gen&, std::size_t>>
+		struct Feed {
+			using Input = std::decay_t<std::invoke_result_t<Gen&, std::size_t>>;
+			Gen& gen;
+			std::size_t i = 0;
 
-			if (!have_plan) {
-				line() << "1.." << run << std::endl;
+			Feed(Gen& gen) : gen(gen) { }
+
+			bool next(std::vector<Input>& batch) {
+				batch.push_back(gen(i++));
+				return true;
 			}
-			else {
-				if (planned != run) {
-					diag("Looks like you planned " + std::to_string(planned) +
-					    " tests but ran " + std::to_string(run));
-				}
+		};
+
+		template<typename Gen>
+		struct Feed<Gen, false> {
+			using Input = std::decay_t<decltype(*std::begin(std::declval<Gen&>()))>;
+			decltype(std::begin(std::declval<Gen&>())) it, end;
+
+			Feed(Gen& gen) : it(std::begin(gen)), end(std::end(gen)) { }
+
+			bool next(std::vector<Input>& batch) {
+				if (it == end)
+					return false;
+				batch.push_back(*it++);
+				return true;
 			}
+		};
 
-			/* Report subtest summary to parent */
-			if (parent)
-				parent->ok(summary(), description);
+	}
 
-			finished = true;
-		}
+	/**
+	 * A sentinel type accepted by the Context constructor to indicate
+	 * that all tests should be skipped.
+	 */
+	enum skip_all { SKIP_ALL };
+
+	/**
+	 * Cost tiers of test runs, from quick checks on every change to
+	 * everything in nightly runs. See `Context::tier`.
+	 */
+	enum class Tier { smoke, full, exhaustive };
+
+	/**
+	 * A pool of worker threads which balance tasks by work stealing.
+	 * Each worker owns a Chase-Lev deque: it pushes and pops tasks at
+	 * the bottom while other workers steal from the top. Tasks submitted
+	 * from outside the pool go through a shared queue. Workers which
+	 * find nothing to do park until new tasks arrive.
+	 *
+	 * Tasks are run in a Group, whose `wait` helps running tasks until
+	 * all of the group's tasks are done. Groups can therefore be nested
+	 * without deadlocks: a task may start a group of its own and wait
+	 * for it. A waiting thread only helps with the tasks it submitted
+	 * since it created the group and with the group's tasks from the
+	 * shared queue, never with unrelated work like a sibling subtest of
+	 * `run_parallel`, which would be timed as part of the waiting task.
+	 * The group's tasks which other workers took are run by them.
+	 * The library runs its parallel work on the `shared`
+	 * executor, which tests can use as well to not oversubscribe the
+	 * machine.
+	 */
+	class Executor {
+	public:
+		class Group;
+
+	private:
+		struct Task {
+			std::function<void(void)> f;
+			Group* group;
+		};
 
 		/**
-		 * Write an "ok" or "not ok" line depending on the `is_ok`
-		 * argument.
+		 * The work-stealing deque of Chase and Lev, with the memory
+		 * orderings of Lê et al., "Correct and Efficient Work-Stealing
+		 * for Weak Memory Models" (PPoPP 2013), except that slots are
+		 * published by release stores instead of a fence, which thread
+		 * sanitizers understand. Rings which are outgrown
+		 * are kept until the deque is destroyed, because a thief may
+		 * still read from them.
 		 */
-		bool ok(bool is_ok, const std::string& message = "") {
-			if (finished)
-				throw TAP::X::Finished();
+		class Deque {
+			struct Ring {
+				std::int64_t size;
+				std::unique_ptr<std::atomic<Task*>[]> slots;
 
-			line() << (is_ok ? "ok " : "not ok ")
-			       << ++run << " - "
-				   << message;
-			if (!todo.empty()) {
-				out << (message.empty() ? "" : " ");
-				out << "# TODO " << todo;
-				/* Count failed TODOs */
-				if (not is_ok)
-					++todos;
-				todo.clear();
+				Ring(std::int64_t size) : size(size), slots(new std::atomic<Task*>[size]) { }
+
+				Task* get(std::int64_t i) const {
+					return slots[i & (size - 1)].load(std::memory_order_acquire);
+				}
+
+				void put(std::int64_t i, Task* t) {
+					slots[i & (size - 1)].store(t, std::memory_order_release);
+				}
+			};
+
+			std::atomic<std::int64_t> top{0}, bottom{0};
+			std::atomic<Ring*> ring;
+			std::vector<std::unique_ptr<Ring>> rings;
+
+		public:
+			Deque(void) {
+				rings.push_back(std::make_unique<Ring>(64));
+				ring = rings.back().get();
 			}
-			out << std::endl;
 
-			if (is_ok)
-				++good;
+			/**
+			 * Push a task at the bottom. Only the owner may call this.
+			 */
+			void push(Task* t) {
+				std::int64_t b = bottom.load(std::memory_order_relaxed);
+				std::int64_t tp = top.load(std::memory_order_acquire);
+				Ring* r = ring.load(std::memory_order_relaxed);
+				if (b - tp > r->size - 1) {
+					auto bigger = std::make_unique<Ring>(2 * r->size);
+					for (std::int64_t i = tp; i < b; ++i)
+						bigger->put(i, r->get(i));
+					r = bigger.get();
+					rings.push_back(std::move(bigger));
+					ring.store(r, std::memory_order_release);
+				}
+				r->put(b, t);
+				bottom.store(b + 1, std::memory_order_release);
+			}
 
-			return is_ok;
-		}
+			/**
+			 * Pop the most recently pushed task. Only the owner may
+			 * call this.
+			 */
+			Task* pop(void) {
+				std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+				Ring* r = ring.load(std::memory_order_relaxed);
+				bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t t = top.load(std::memory_order_relaxed);
+				if (t > b) {
+					bottom.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				Task* x = r->get(b);
+				if (t == b) {
+					/* Last task: race the thieves for it */
+					if (not top.compare_exchange_strong(t, t + 1,
+					    std::memory_order_seq_cst, std::memory_order_relaxed))
+						x = nullptr;
+					bottom.store(b + 1, std::memory_order_relaxed);
+				}
+				return x;
+			}
+
+			/**
+			 * One past the index of the most recently pushed task.
+			 * Only the owner may call this.
+			 */
+			std::int64_t end(void) const {
+				return bottom.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * Steal the least recently pushed task. Any thread may call
+			 * this. It returns null when the deque is empty or another
+			 * thread took the task first.
+			 */
+			Task* steal(void) {
+				std::int64_t t = top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t b = bottom.load(std::memory_order_acquire);
+				if (t >= b)
+					return nullptr;
+				Ring* r = ring.load(std::memory_order_acquire);
+				Task* x = r->get(t);
+				if (not top.compare_exchange_strong(t, t + 1,
+				    std::memory_order_seq_cst, std::memory_order_relaxed))
+					return nullptr;
+				return x;
+			}
+		};
+
+		struct Worker {
+			Deque deque;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		std::mutex queue_mtx;
+		std::deque<Task*> queue;            /**< Tasks from outside     */
+		std::atomic<std::size_t> queued{0};
 
+		std::mutex park_mtx;
+		std::condition_variable park_cv;
+		std::atomic<std::uint64_t> epoch{0}; /**< Bumped by every wakeup */
+		std::atomic<unsigned int> idle{0};  /**< Threads about to park  */
+		bool stopping = false;
+
+		/* The executor and index of the worker running on this thread */
+		static inline thread_local Executor* self = nullptr;
+		static inline thread_local std::size_t self_index = 0;
+
+		/* Seed of the delays before every task, 0 for none, see `perturb` */
+		static inline std::atomic<std::uint64_t> jitter{0};
+
+	public:
 		/**
-		 * Like `ok` but negates the bool first.
+		 * Start an executor with the given number of worker threads.
 		 */
-		bool nok(bool is_nok, const std::string& message = "") {
-			return ok(not is_nok, message);
+		explicit Executor(unsigned int threads) {
+			threads = std::max(threads, 1U);
+			for (unsigned int i = 0; i < threads; ++i)
+				workers.push_back(std::make_unique<Worker>());
+			for (unsigned int i = 0; i < threads; ++i) {
+				workers[i]->thread = std::thread([this, i] {
+					self = this;
+					self_index = i;
+					work_until([] { return false; });
+				});
+			}
 		}
 
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+
 		/**
-		 * Pass a test unconditionally.
+		 * Stop the workers. All groups must have been waited for.
 		 */
-		bool pass(const std::string& message = "") {
-			return ok(true, message);
+		~Executor(void) {
+			{
+				std::lock_guard<std::mutex> lock(park_mtx);
+				stopping = true;
+			}
+			park_cv.notify_all();
+			for (auto& w : workers)
+				w->thread.join();
 		}
 
 		/**
-		 * Fail a test unconditionally.
+		 * The executor shared by the library and the tests. It is
+		 * started on first use with `jobs()` worker threads.
 		 */
-		bool fail(const std::string& message = "") {
-			return ok(false, message);
+		static Executor& shared(void) {
+			static Executor ex(jobs());
+			return ex;
 		}
 
 		/**
-		 * Mark the next test as "to-do". The next "ok" / "not ok"
-		 * line will be printed with the TODO directive, but only
-		 * if the reason string is non-empty.
+		 * The number of worker threads.
 		 */
-		void TODO(const std::string& reason = "-") {
-			if (finished)
-				throw TAP::X::Finished();
-			todo = reason;
+		unsigned int size(void) const {
+			return workers.size();
 		}
 
 		/**
-		 * Skip a test by emitting a `pass` with the SKIP directive.
+		 * Perturb the schedule of all executors: with a nonzero `seed`,
+		 * every task is delayed by a yield or a sleep of up to 63
+		 * microseconds, chosen at random, before it runs. This provokes
+		 * interleavings which an idle machine rarely shows. Zero turns
+		 * it off again.
 		 */
-		void SKIP(const std::string& reason = "") {
-			pass("# SKIP" + std::string(reason.empty() ? "" : " ") + reason);
+		static void perturb(std::uint64_t seed) {
+			jitter.store(seed, std::memory_order_relaxed);
 		}
 
 		/**
-		 * Skip the given number of tests by emitting `pass`es with
-		 * the SKIP directive. The reason is repeated for every `pass`
-		 * but a counter is added.
+		 * A set of tasks which can be waited for. The first exception
+		 * thrown by one of its tasks is rethrown by `wait`.
 		 */
-		void SKIP(unsigned int how_many, const std::string& reason = "") {
-			auto current_of = [&] (unsigned int cur) {
-				std::string ret = reason.empty() ? "" : " ";
-				ret += std::to_string(1 + cur) + "/" + std::to_string(how_many);
-				return ret;
-			};
-			for (unsigned int i = 0; i < how_many; ++i)
-				SKIP(reason + current_of(i));
-		}
+		class Group {
+			friend class Executor;
+			Executor& ex;
+			std::atomic<std::size_t> pending{0};
+			std::mutex error_mtx;
+			std::exception_ptr error;
+			/* The creating worker and the end of its deque at the time,
+			 * above which it may help, or -1 outside of the pool */
+			std::size_t owner = 0;
+			std::int64_t base = -1;
 
-		/**
-		 * Print a "Bail out!" message but does not exit.
-		 * Clients should do that after calling this function
+		public:
+			explicit Group(Executor& ex = Executor::shared()) : ex(ex) {
+				if (self == &ex) {
+					owner = self_index;
+					base = ex.workers[owner]->deque.end();
+				}
+			}
+
+			Group(const Group&) = delete;
+			Group& operator=(const Group&) = delete;
+
+			/**
+			 * Waits for the remaining tasks but swallows their
+			 * exceptions. Call `wait` to see them.
+			 */
+			~Group(void) {
+				ex.work_until([this] { return pending.load() == 0; }, this);
+			}
+
+			/**
+			 * Submit `f` to run on the executor.
+			 */
+			template<typename F>
+			void run(F&& f) {
+				pending.fetch_add(1);
+				ex.submit(new Task{ std::forward<F>(f), this });
+			}
+
+			/**
+			 * Run tasks until all tasks of this group are done. Only
+			 * this group's tasks and those which this thread submitted
+			 * since creating the group are run here.
+			 */
+			void wait(void) {
+				ex.work_until([this] { return pending.load() == 0; }, this);
+				std::exception_ptr e;
+				{
+					std::lock_guard<std::mutex> lock(error_mtx);
+					std::swap(e, error);
+				}
+				if (e)
+					std::rethrow_exception(e);
+			}
+		};
+
+		/**
+		 * Call `f(i)` for every `i` below `n`, on this thread and up to
+		 * `size() - 1` workers. The indices are handed out dynamically.
+		 */
+		template<typename F>
+		void parallel_for(std::size_t n, F&& f) {
+			std::atomic<std::size_t> next{0};
+			auto work = [&] {
+				for (std::size_t i; (i = next++) < n; )
+					f(i);
+			};
+			Group group(*this);
+			for (std::size_t t = 1; t < std::min<std::size_t>(size(), n); ++t)
+				group.run(work);
+			work();
+			group.wait();
+		}
+
+	private:
+		void submit(Task* t) {
+			if (self == this) {
+				workers[self_index]->deque.push(t);
+			}
+			else {
+				std::lock_guard<std::mutex> lock(queue_mtx);
+				queue.push_back(t);
+				queued.fetch_add(1);
+			}
+			wake(false);
+		}
+
+		/**
+		 * Publish new work or a finished group to parked threads.
+		 * The fence pairs with the one in `work_until` so that either
+		 * the parking thread sees the change or we see it parking.
+		 */
+		void wake(bool all) {
+			epoch.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (idle.load() == 0)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(park_mtx);
+			}
+			if (all)
+				park_cv.notify_all();
+			else
+				park_cv.notify_one();
+		}
+
+		/**
+		 * Find a task to run, or only one that a thread waiting for the
+		 * group `only` may help with, see `Group::wait`.
+		 */
+		Task* find(const Group* only = nullptr) {
+			if (self == this) {
+				Deque& own = workers[self_index]->deque;
+				if (not only or (only->base >= 0 and only->owner == self_index and own.end() > only->base)) {
+					if (Task* t = own.pop())
+						return t;
+				}
+			}
+			if (queued.load() > 0) {
+				std::lock_guard<std::mutex> lock(queue_mtx);
+				auto it = std::find_if(queue.begin(), queue.end(),
+				    [&] (const Task* t) { return not only or t->group == only; });
+				if (it != queue.end()) {
+					Task* t = *it;
+					queue.erase(it);
+					queued.fetch_sub(1);
+					return t;
+				}
+			}
+			if (only)
+				return nullptr;
+			static thread_local std::uint64_t victim = mix64(
+			    std::hash<std::thread::id>()(std::this_thread::get_id()));
+			std::size_t n = workers.size();
+			std::size_t start = victim++ % n;
+			for (std::size_t k = 0; k < n; ++k) {
+				if (Task* t = workers[(start + k) % n]->deque.steal())
+					return t;
+			}
+			return nullptr;
+		}
+
+		/**
+		 * Delay the next task as `perturb` describes.
+		 */
+		static void delay(std::uint64_t seed) {
+			static thread_local std::uint64_t n = mix64(
+			    std::hash<std::thread::id>()(std::this_thread::get_id()));
+			std::uint64_t r = mix64(seed ^ ++n);
+			if (r & 1)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(r >> 58));
+		}
+
+		void execute(Task* t) {
+			Group* g = t->group;
+			if (std::uint64_t seed = jitter.load(std::memory_order_relaxed))
+				delay(seed);
+			try {
+				t->f();
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(g->error_mtx);
+				if (not g->error)
+					g->error = std::current_exception();
+			}
+			delete t;
+			/* The group may be gone as soon as pending drops to zero */
+			if (g->pending.fetch_sub(1) == 1)
+				wake(true);
+		}
+
+		/**
+		 * Run tasks until `done()` holds, parking when there are none.
+		 * Workers run this with a condition that never holds until the
+		 * executor is stopped. A thread waiting for the group `only`
+		 * runs only tasks it may help with.
+		 */
+		template<typename Done>
+		void work_until(Done done, const Group* only = nullptr) {
+			while (not done()) {
+				if (Task* t = find(only)) {
+					execute(t);
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(park_mtx);
+				if (stopping)
+					return;
+				std::uint64_t seen = epoch.load();
+				idle.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				Task* t = done() ? nullptr : find(only);
+				if (t == nullptr and not done())
+					park_cv.wait(lock, [&] { return epoch.load() != seen or stopping; });
+				idle.fetch_sub(1);
+				lock.unlock();
+				if (t)
+					execute(t);
+			}
+		}
+	};
+
+	/**
+	 * The default Matcher of `is` and `isnt`. It compares values of
+	 * different types without converting one into the other: strings,
+	 * string views, C strings and character arrays by their contents,
+	 * integers by their values regardless of signedness (like C++20's
+	 * `std::cmp_equal`) and everything else with `==`. `nullptr` is
+	 * not a string but a null pointer. Signed and unsigned char count
+	 * as integers, because they are `std::int8_t` and `std::uint8_t`,
+	 * while the other character types are left alone.
+	 */
+	struct Equal {
+		using is_transparent = void;
+
+		template<typename T, typename U>
+		bool operator()(const T& a, const U& b) const {
+			if constexpr (is_string<T>() and is_string<U>()) {
+				if constexpr (is_pointer<T>() or is_pointer<U>()) {
+					if (is_null(a) or is_null(b))
+						return is_null(a) and is_null(b);
+				}
+				return std::string_view(a) == std::string_view(b);
+			}
+			else if constexpr (is_integer<T>() and is_integer<U>()) {
+				if constexpr (std::is_signed_v<T> == std::is_signed_v<U>)
+					return a == b;
+				else if constexpr (std::is_signed_v<T>)
+					return a >= 0 and std::make_unsigned_t<T>(a) == b;
+				else
+					return b >= 0 and std::make_unsigned_t<U>(b) == a;
+			}
+			else {
+				return a == b;
+			}
+		}
+
+	private:
+		template<typename T>
+		static constexpr bool is_pointer(void) {
+			return std::is_pointer_v<T> or std::is_null_pointer_v<T>;
+		}
+
+		template<typename T>
+		static constexpr bool is_string(void) {
+			return std::is_convertible_v<const T&, std::string_view> and
+			    not std::is_null_pointer_v<T>;
+		}
+
+		template<typename T>
+		static constexpr bool is_integer(void) {
+			using V = std::remove_cv_t<T>;
+			return std::is_integral_v<V> and not std::is_same_v<V, bool> and
+			    not std::is_same_v<V, char> and not std::is_same_v<V, wchar_t> and
+#ifdef __cpp_char8_t
+			    not std::is_same_v<V, char8_t> and
+#endif
+			    not std::is_same_v<V, char16_t> and not std::is_same_v<V, char32_t>;
+		}
+
+		template<typename T>
+		static bool is_null(const T& x) {
+			if constexpr (std::is_null_pointer_v<T>)
+				return true;
+			else if constexpr (std::is_pointer_v<T>)
+				return x == nullptr;
+			else
+				return false;
+		}
+	};
+
+	/**
+	 * A fixed-size latency histogram. Values are unsigned nanosecond
+	 * counts which are sorted into log-linear buckets: every power of
+	 * two is split into 16 linear sub-buckets, so that the relative
+	 * error of a reported value is at most 1/16. The memory footprint
+	 * is constant no matter how many values are recorded, and two
+	 * histograms can be merged by adding their buckets.
+	 */
+	class Histogram {
+		static constexpr unsigned int SUB     = 16;
+		static constexpr unsigned int BUCKETS = (64 - 3) * SUB;
+
+		std::array<std::uint64_t, BUCKETS> buckets{}; /**< Bucket counters */
+		std::uint64_t n     = 0; /**< Number of recorded values */
+		std::uint64_t lo    = std::numeric_limits<std::uint64_t>::max();
+		std::uint64_t hi    = 0; /**< Largest recorded value    */
+		long double   total = 0; /**< Sum of all values         */
+
+		static unsigned int msb(std::uint64_t v) {
+#if defined(__GNUC__)
+			return 63 - __builtin_clzll(v);
+#else
+			unsigned int m = 0;
+			while (v >>= 1)
+				++m;
+			return m;
+#endif
+		}
+
+		static unsigned int index(std::uint64_t v) {
+			if (v < SUB)
+				return v;
+			unsigned int m = msb(v);
+			return (m - 3) * SUB + ((v >> (m - 4)) - SUB);
+		}
+
+		/**
+		 * The largest value which is sorted into bucket `i`.
+		 */
+		static std::uint64_t upper(unsigned int i) {
+			if (i < SUB)
+				return i;
+			unsigned int m = i / SUB + 3;
+			std::uint64_t lower = std::uint64_t(SUB + i % SUB) << (m - 4);
+			return lower + ((std::uint64_t(1) << (m - 4)) - 1);
+		}
+
+	public:
+		/**
+		 * Record a single value.
+		 */
+		void record(std::uint64_t ns) {
+			++buckets[index(ns)];
+			++n;
+			total += ns;
+			if (ns < lo) lo = ns;
+			if (ns > hi) hi = ns;
+		}
+
+		/**
+		 * Record a duration with nanosecond resolution. Negative
+		 * durations are recorded as zero.
+		 */
+		template<typename Rep, typename Period>
+		void record(std::chrono::duration<Rep, Period> d) {
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+			record(std::uint64_t(ns < 0 ? 0 : ns));
+		}
+
+		/**
+		 * Add all values recorded in another histogram to this one.
+		 */
+		void merge(const Histogram& other) {
+			for (unsigned int i = 0; i < BUCKETS; ++i)
+				buckets[i] += other.buckets[i];
+			n += other.n;
+			total += other.total;
+			if (other.lo < lo) lo = other.lo;
+			if (other.hi > hi) hi = other.hi;
+		}
+
+		/**
+		 * Forget all recorded values.
+		 */
+		void reset(void) {
+			*this = Histogram();
+		}
+
+		std::uint64_t count(void) const { return n;               }
+		std::uint64_t min(void)   const { return n ? lo : 0;      }
+		std::uint64_t max(void)   const { return hi;              }
+		double        mean(void)  const { return n ? total / n : 0; }
+
+		/**
+		 * Return the value below or at which the fraction `q` (between
+		 * 0 and 1) of all recorded values lie. The result is accurate
+		 * up to the bucket resolution and never exceeds `max()`.
+		 */
+		std::uint64_t percentile(double q) const {
+			if (n == 0)
+				return 0;
+			q = q < 0 ? 0 : q > 1 ? 1 : q;
+			std::uint64_t rank = std::ceil(q * n);
+			if (rank == 0)
+				rank = 1;
+			std::uint64_t seen = 0;
+			for (unsigned int i = 0; i < BUCKETS; ++i) {
+				seen += buckets[i];
+				if (seen >= rank)
+					return std::min(std::max(upper(i), min()), hi);
+			}
+			return hi;
+		}
+	};
+
+	/**
+	 * Summarize a Histogram, assuming its values are nanoseconds.
+	 */
+	inline std::ostream& operator<<(std::ostream& out, const Histogram& h) {
+		auto us = [] (std::uint64_t ns) { return ns / 1000.0; };
+		return out << "n=" << h.count()
+		           << " min=" << us(h.min()) << "us"
+		           << " p50=" << us(h.percentile(0.50)) << "us"
+		           << " p90=" << us(h.percentile(0.90)) << "us"
+		           << " p99=" << us(h.percentile(0.99)) << "us"
+		           << " max=" << us(h.max()) << "us";
+	}
+
+	/**
+	 * Tools for measuring the performance of code under test.
+	 */
+	namespace Bench {
+		/**
+		 * How the arrival times of an open-loop load are spaced.
+		 */
+		enum class Arrivals {
+			Fixed,   /**< Evenly spaced at the given rate       */
+			Poisson, /**< Exponential gaps averaging the rate   */
+		};
+
+		/**
+		 * Parameters of an open-loop load.
+		 */
+		struct Load {
+			double rate = 1000;               /**< Calls per second   */
+			std::chrono::nanoseconds length = std::chrono::seconds(1);
+			unsigned int workers = 4;         /**< Calling threads    */
+			Arrivals arrivals = Arrivals::Fixed;
+			std::uint64_t seed = 0;           /**< Seed for Poisson   */
+		};
+
+		/**
+		 * Result of an open-loop load. The `latency` histogram measures
+		 * every call from the time it was scheduled to start, which
+		 * includes the time it had to wait for a worker, while `service`
+		 * measures from when the call actually started.
+		 */
+		struct LoadReport {
+			Load load;
+			Histogram latency;       /**< Since intended start */
+			Histogram service;       /**< Since actual start   */
+			std::uint64_t calls  = 0; /**< Completed calls     */
+			std::uint64_t errors = 0; /**< Calls which threw   */
+			std::chrono::nanoseconds elapsed{0};
+
+			/**
+			 * Calls per second over the load's length. Every scheduled
+			 * call is completed, so this is the rate the schedule really
+			 * offered, which for Poisson arrivals differs by chance.
+			 */
+			double offered(void) const {
+				double s = std::chrono::duration<double>(load.length).count();
+				return s > 0 ? calls / s : 0;
+			}
+
+			/**
+			 * Completed calls per second over the whole run, which is
+			 * lower than `offered` if the calls fell behind.
+			 */
+			double throughput(void) const {
+				double s = std::chrono::duration<double>(elapsed).count();
+				return s > 0 ? calls / s : 0;
+			}
+		};
+
+		/**
+		 * Issue calls to `f` at the arrival rate described by `load`
+		 * from `load.workers` tasks on the shared Executor, or on an
+		 * executor of their own if the shared one has fewer threads.
+		 * The schedule of start times is fixed in advance and does not
+		 * wait for slow calls, so when the code under test stalls, the
+		 * calls piling up behind it are charged with their waiting time.
+		 * Latencies are recorded into per-worker histograms which are
+		 * merged at the end. A rate which is not positive throws
+		 * std::invalid_argument.
+		 */
+		template<typename F>
+		LoadReport load(const Load& load, F&& f) {
+			using clock = std::chrono::steady_clock;
+			if (not (load.rate > 0))
+				throw std::invalid_argument("load rate must be positive");
+			LoadReport report;
+			report.load = load;
+
+			unsigned int workers = load.workers ? load.workers : 1;
+			auto start = clock::now() + std::chrono::milliseconds(1);
+			auto end   = start + load.length;
+			/* The fixed gap is rounded to whole nanoseconds once, so the
+			 * schedule is integer arithmetic from there on. */
+			std::chrono::nanoseconds gap(std::max<long long>(1, std::llround(1e9 / load.rate)));
+
+			std::mutex mtx;
+			std::mt19937_64 rng(load.seed);
+			std::exponential_distribution<double> poisson(load.rate);
+			std::uint64_t issued = 0;
+			auto intended = start;
+			/* Hand out the next scheduled start time, if any. */
+			auto next = [&] (clock::time_point& t) {
+				std::lock_guard<std::mutex> lock(mtx);
+				if (load.arrivals == Arrivals::Fixed)
+					t = start + std::chrono::duration_cast<clock::duration>(gap * static_cast<std::int64_t>(issued));
+				else
+					t = intended += std::chrono::duration_cast<clock::duration>(
+						std::chrono::duration<double>(poisson(rng)));
+				++issued;
+				return t < end;
+			};
+
+			std::unique_ptr<Executor> own;
+			Executor* ex = &Executor::shared();
+			if (workers > ex->size())
+				ex = (own = std::make_unique<Executor>(workers)).get();
+
+			std::vector<LoadReport> partial(workers);
+			Executor::Group pool(*ex);
+			for (unsigned int w = 0; w < workers; ++w) {
+				pool.run([&, w] {
+					LoadReport& mine = partial[w];
+					clock::time_point t;
+					while (next(t)) {
+						std::this_thread::sleep_until(t);
+						auto s = clock::now();
+						try {
+							f();
+						}
+						catch (...) {
+							++mine.errors;
+						}
+						auto e = clock::now();
+						mine.latency.record(e - t);
+						mine.service.record(e - s);
+						++mine.calls;
+					}
+				});
+			}
+			pool.wait();
+
+			report.elapsed = clock::now() - start;
+			for (auto& p : partial) {
+				report.latency.merge(p.latency);
+				report.service.merge(p.service);
+				report.calls  += p.calls;
+				report.errors += p.errors;
+			}
+			return report;
+		}
+
+#ifdef TAPPP_POSIX
+		/**
+		 * Parameters of a file I/O benchmark.
+		 */
+		struct FileIO {
+			std::vector<std::string> files;   /**< Files the workload reads */
+			unsigned int runs = 3;            /**< Timed runs per state     */
+			std::size_t block = 1 << 20;      /**< Read size of read_files  */
+			bool direct = false;              /**< O_DIRECT in read_files   */
+		};
+
+		/**
+		 * What one run of a file I/O workload read.
+		 */
+		struct IOCount {
+			std::uint64_t bytes = 0;          /**< Bytes read               */
+			std::uint64_t ops = 0;            /**< Read calls issued        */
+		};
+
+		/**
+		 * The runs of a file I/O workload in one page cache state.
+		 */
+		struct IOStats {
+			unsigned int runs = 0;
+			std::uint64_t bytes = 0;
+			std::uint64_t ops = 0;
+			std::chrono::nanoseconds elapsed{0};
+
+			/**
+			 * Bytes read per second.
+			 */
+			double throughput(void) const {
+				double s = std::chrono::duration<double>(elapsed).count();
+				return s > 0 ? bytes / s : 0;
+			}
+
+			/**
+			 * Read operations per second.
+			 */
+			double iops(void) const {
+				double s = std::chrono::duration<double>(elapsed).count();
+				return s > 0 ? ops / s : 0;
+			}
+		};
+
+		/**
+		 * Result of a file I/O benchmark, with separate totals for runs
+		 * with a cold and a warm page cache. `cached` is the largest
+		 * fraction of the files' pages which was still in the cache at
+		 * the start of a cold run. It should be zero; file systems which
+		 * keep files in memory, like tmpfs, cannot evict them. It is
+		 * only measured on Linux and negative elsewhere.
+		 */
+		struct FileIOReport {
+			FileIO io;
+			IOStats cold;
+			IOStats warm;
+			double cached = -1;
+		};
+
+		/**
+		 * Write back the dirty pages of the files and drop all their
+		 * pages from the page cache. Pages which some process has mapped
+		 * stay. This needs no privileges.
+		 */
+		inline void evict(const std::vector<std::string>& files) {
+			for (const auto& f : files) {
+				int fd = ::open(f.c_str(), O_RDONLY);
+				if (fd < 0)
+					throw std::system_error(errno, std::generic_category(), f);
+				::fdatasync(fd);
+#ifdef POSIX_FADV_DONTNEED
+				::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+				::close(fd);
+			}
+		}
+
+		/**
+		 * The fraction of the pages of the files which are in the page
+		 * cache, or -1 where this cannot be determined.
+		 */
+		inline double cached_fraction(const std::vector<std::string>& files) {
+#ifdef __linux__
+			std::uint64_t pages = 0, resident = 0;
+			std::size_t page = ::sysconf(_SC_PAGESIZE);
+			for (const auto& f : files) {
+				int fd = ::open(f.c_str(), O_RDONLY);
+				if (fd < 0)
+					throw std::system_error(errno, std::generic_category(), f);
+				struct stat st;
+				if (::fstat(fd, &st) == 0 and st.st_size > 0) {
+					std::size_t length = st.st_size;
+					void* p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+					if (p != MAP_FAILED) {
+						std::vector<unsigned char> vec((length + page - 1) / page);
+						if (::mincore(p, length, vec.data()) == 0) {
+							pages += vec.size();
+							for (auto v : vec)
+								resident += v & 1;
+						}
+						::munmap(p, length);
+					}
+				}
+				::close(fd);
+			}
+			return pages ? static_cast<double>(resident) / pages : 0;
+#else
+			return -1;
+#endif
+		}
+
+		/**
+		 * Read the files of `io` sequentially in blocks of `io.block`
+		 * bytes. If `io.direct` is set, they are opened with O_DIRECT,
+		 * where the system has it, which bypasses the page cache even in
+		 * warm runs. Direct reads need a block size which is a multiple
+		 * of the device's logical block size, and file systems which do
+		 * not support them make this throw std::system_error.
+		 */
+		inline IOCount read_files(const FileIO& io) {
+			const std::size_t align = 4096;
+			std::size_t block = std::max<std::size_t>(io.block, 1);
+			std::size_t size = (block + align - 1) / align * align;
+			std::unique_ptr<char, decltype(&std::free)> buf(
+			    static_cast<char*>(std::aligned_alloc(align, size)), &std::free);
+			if (not buf)
+				throw std::bad_alloc();
+
+			int flags = O_RDONLY;
+#ifdef O_DIRECT
+			if (io.direct)
+				flags |= O_DIRECT;
+#endif
+			IOCount count;
+			for (const auto& f : io.files) {
+				int fd = ::open(f.c_str(), flags);
+				if (fd < 0)
+					throw std::system_error(errno, std::generic_category(), f);
+				for (;;) {
+					ssize_t n = ::read(fd, buf.get(), block);
+					if (n < 0 and errno == EINTR)
+						continue;
+					if (n < 0) {
+						int err = errno;
+						::close(fd);
+						throw std::system_error(err, std::generic_category(), f);
+					}
+					if (n == 0)
+						break;
+					count.bytes += n;
+					++count.ops;
+				}
+				::close(fd);
+			}
+			return count;
+		}
+
+		/**
+		 * Run the file I/O workload `f`, which reads `io.files` and
+		 * returns their IOCount, `io.runs` times with a cold and as many
+		 * times with a warm page cache. The files are evicted before
+		 * every cold run. The warm runs follow one untimed run which
+		 * loads the files into the cache.
+		 */
+		template<typename F>
+		FileIOReport file_io(const FileIO& io, F&& f) {
+			using clock = std::chrono::steady_clock;
+			FileIOReport report;
+			report.io = io;
+
+			auto timed = [&] (IOStats& stats) {
+				auto start = clock::now();
+				IOCount c = f();
+				stats.elapsed += clock::now() - start;
+				stats.bytes += c.bytes;
+				stats.ops += c.ops;
+				++stats.runs;
+			};
+			for (unsigned int r = 0; r < io.runs; ++r) {
+				evict(io.files);
+				report.cached = std::max(report.cached, cached_fraction(io.files));
+				timed(report.cold);
+			}
+			f();
+			for (unsigned int r = 0; r < io.runs; ++r)
+				timed(report.warm);
+			return report;
+		}
+
+		/**
+		 * Benchmark `read_files` on the files of `io`.
+		 */
+		inline FileIOReport file_io(const FileIO& io) {
+			return file_io(io, [&] { return read_files(io); });
+		}
+
+		/**
+		 * Summarize the runs in one page cache state.
+		 */
+		inline std::ostream& operator<<(std::ostream& out, const IOStats& s) {
+			return out << s.runs << " runs, "
+			           << s.throughput() / 1e6 << " MB/s, "
+			           << s.iops() << " IOPS";
+		}
+
+		/**
+		 * Summarize a file I/O benchmark.
+		 */
+		inline std::ostream& operator<<(std::ostream& out, const FileIOReport& r) {
+			out << "cold: " << r.cold << "; warm: " << r.warm;
+			if (r.cached > 0)
+				out << "; " << 100 * r.cached << "% cached before cold runs";
+			return out;
+		}
+
+		/**
+		 * What backs the memory of a Buffer.
+		 */
+		enum class Pages {
+			Base,        /**< Pages of the base size               */
+			Transparent, /**< Transparent huge pages, if enabled   */
+			HugeTLB,     /**< Huge pages from the hugetlbfs pool   */
+		};
+
+		/**
+		 * Zeroed memory for the inputs of a benchmark, which does not
+		 * page fault while the benchmark is measured. It is mapped
+		 * anonymously, backed by huge pages if requested to cut down on
+		 * TLB misses, pre-faulted and optionally locked into RAM.
+		 */
+		class Buffer {
+			void* base = MAP_FAILED;     /**< The whole mapping     */
+			std::size_t mapped = 0;
+			unsigned char* start = nullptr;
+			std::size_t length = 0;
+			bool is_locked = false;
+
+			static std::size_t round_up(std::size_t n, std::size_t to) {
+				return (n + to - 1) / to * to;
+			}
+
+		public:
+			/**
+			 * The default huge page size, `Hugepagesize` in
+			 * /proc/meminfo, or 2 MiB where that is not available.
+			 */
+			static std::size_t huge_page(void) {
+				static const std::size_t size = [] {
+					std::ifstream meminfo("/proc/meminfo");
+					for (std::string line; std::getline(meminfo, line); ) {
+						std::istringstream in(line);
+						std::string field;
+						std::size_t kb = 0;
+						if (in >> field >> kb and field == "Hugepagesize:" and kb > 0)
+							return kb * 1024;
+					}
+					return std::size_t(2) << 20;
+				}();
+				return size;
+			}
+
+			/**
+			 * Map `size` bytes backed by `pages`. Transparent huge
+			 * pages are requested with madvise(MADV_HUGEPAGE) on a
+			 * mapping aligned to a huge page, and the kernel may still
+			 * use base pages, e.g. when THP is disabled. HugeTLB pages
+			 * come from the pool reserved in /proc/sys/vm/nr_hugepages,
+			 * and std::system_error is thrown if it is exhausted.
+			 * If `lock` is set, the buffer is mlock'ed if the limit on
+			 * locked memory allows it; see `locked`.
+			 */
+			explicit Buffer(std::size_t size, Pages pages = Pages::Transparent, bool lock = false) :
+				length(size)
+			{
+				std::size_t page = ::sysconf(_SC_PAGESIZE);
+				std::size_t huge = huge_page();
+				std::size_t want = round_up(std::max<std::size_t>(size, 1), page);
+				int prot = PROT_READ | PROT_WRITE;
+				int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+				/* With THP, this would fault in base pages before madvise */
+				if (pages != Pages::Transparent)
+					flags |= MAP_POPULATE;
+#endif
+				if (pages == Pages::HugeTLB) {
+#ifdef MAP_HUGETLB
+					mapped = round_up(want, huge);
+					base = ::mmap(nullptr, mapped, prot, flags | MAP_HUGETLB, -1, 0);
+#else
+					errno = ENOTSUP;
+#endif
+					if (base == MAP_FAILED)
+						throw std::system_error(errno, std::generic_category(), "mmap(MAP_HUGETLB)");
+					start = static_cast<unsigned char*>(base);
+				}
+				else if (pages == Pages::Transparent) {
+					mapped = round_up(want, huge) + huge;
+					base = ::mmap(nullptr, mapped, prot, flags, -1, 0);
+					if (base == MAP_FAILED)
+						throw std::system_error(errno, std::generic_category(), "mmap");
+					auto addr = reinterpret_cast<std::uintptr_t>(base);
+					start = reinterpret_cast<unsigned char*>(round_up(addr, huge));
+#ifdef MADV_HUGEPAGE
+					::madvise(start, round_up(want, huge), MADV_HUGEPAGE);
+#endif
+				}
+				else {
+					mapped = want;
+					base = ::mmap(nullptr, mapped, prot, flags, -1, 0);
+					if (base == MAP_FAILED)
+						throw std::system_error(errno, std::generic_category(), "mmap");
+					start = static_cast<unsigned char*>(base);
+				}
+
+				/* Write to every page to fault in what is not populated
+				 * yet. Reading would only map the shared zero page. */
+				for (std::size_t i = 0; i < want; i += page)
+					start[i] = 0;
+				if (lock)
+					is_locked = ::mlock(start, want) == 0;
+			}
+
+			Buffer(const Buffer&) = delete;
+			Buffer& operator=(const Buffer&) = delete;
+
+			Buffer(Buffer&& other) noexcept {
+				*this = std::move(other);
+			}
+
+			Buffer& operator=(Buffer&& other) noexcept {
+				std::swap(base, other.base);
+				std::swap(mapped, other.mapped);
+				std::swap(start, other.start);
+				std::swap(length, other.length);
+				std::swap(is_locked, other.is_locked);
+				return *this;
+			}
+
+			~Buffer(void) {
+				if (base != MAP_FAILED)
+					::munmap(base, mapped);
+			}
+
+			unsigned char* data(void) { return start; }
+			const unsigned char* data(void) const { return start; }
+			std::size_t size(void) const { return length; }
+
+			/**
+			 * View the buffer as an array of `T`.
+			 */
+			template<typename T>
+			T* as(void) {
+				return reinterpret_cast<T*>(start);
+			}
+
+			/**
+			 * Whether the buffer is locked into RAM.
+			 */
+			bool locked(void) const {
+				return is_locked;
+			}
+
+			/**
+			 * How many bytes of the buffer are backed by huge pages,
+			 * transparent or from hugetlbfs, according to
+			 * /proc/self/smaps. Zero where that is not available.
+			 */
+			std::size_t huge_bytes(void) const {
+				std::ifstream smaps("/proc/self/smaps");
+				auto lo = reinterpret_cast<std::uintptr_t>(start);
+				auto hi = lo + length;
+				bool inside = false;
+				std::size_t kb = 0;
+				for (std::string line; std::getline(smaps, line); ) {
+					std::istringstream in(line);
+					std::string field;
+					in >> field;
+					if (field.empty())
+						continue;
+					if (field.back() != ':') {
+						/* Header of a mapping: "from-to perms ..." */
+						auto dash = field.find('-');
+						if (dash == std::string::npos)
+							continue;
+						auto from = std::stoull(field.substr(0, dash), nullptr, 16);
+						auto to   = std::stoull(field.substr(dash + 1), nullptr, 16);
+						inside = from < hi and lo < to;
+					}
+					else if (inside and (field == "AnonHugePages:" or
+					    field == "Private_Hugetlb:" or field == "Shared_Hugetlb:")) {
+						std::size_t n = 0;
+						in >> n;
+						kb += n;
+					}
+				}
+				return kb * 1024;
+			}
+		};
+
+		/**
+		 * Running time and page faults of a timed region. The faults
+		 * are counted for the calling thread, and for the whole process,
+		 * which includes work handed to executor workers.
+		 */
+		struct Region {
+			std::chrono::nanoseconds elapsed{0};
+			std::uint64_t minor_faults = 0;   /**< Served from memory */
+			std::uint64_t major_faults = 0;   /**< Needed I/O         */
+			std::uint64_t process_minor_faults = 0; /**< Of all threads */
+			std::uint64_t process_major_faults = 0; /**< Of all threads */
+		};
+
+		/**
+		 * Call `f` and measure its running time and the page faults of
+		 * the calling thread while it runs, or of the whole process
+		 * where per-thread usage is not available, and the page faults
+		 * of the whole process. Page faults in the timed region of a
+		 * benchmark distort it; with its inputs in a Buffer, there
+		 * should be none.
+		 */
+		template<typename F>
+		Region timed(F&& f) {
+			using clock = std::chrono::steady_clock;
+#ifdef RUSAGE_THREAD
+			const int who = RUSAGE_THREAD;
+#else
+			const int who = RUSAGE_SELF;
+#endif
+			Region region;
+			struct rusage before{}, after{}, all_before{}, all_after{};
+			getrusage(RUSAGE_SELF, &all_before);
+			getrusage(who, &before);
+			auto start = clock::now();
+			std::forward<F>(f)();
+			region.elapsed = clock::now() - start;
+			getrusage(who, &after);
+			getrusage(RUSAGE_SELF, &all_after);
+			region.minor_faults = after.ru_minflt - before.ru_minflt;
+			region.major_faults = after.ru_majflt - before.ru_majflt;
+			region.process_minor_faults = all_after.ru_minflt - all_before.ru_minflt;
+			region.process_major_faults = all_after.ru_majflt - all_before.ru_majflt;
+			return region;
+		}
+
+		/**
+		 * Summarize a timed region.
+		 */
+		inline std::ostream& operator<<(std::ostream& out, const Region& r) {
+			return out << std::chrono::duration<double, std::micro>(r.elapsed).count() << "us"
+			           << " minflt=" << r.minor_faults
+			           << " majflt=" << r.major_faults
+			           << " process minflt=" << r.process_minor_faults
+			           << " majflt=" << r.process_major_faults;
+		}
+#endif
+	}
+
+	/**
+	 * A set of strings compiled into an Aho-Corasick automaton, which
+	 * finds all occurrences of all of them in a text in a single pass.
+	 * Building the automaton takes time proportional to the total size
+	 * of the strings, so a Patterns object should be reused for many
+	 * texts. Scanning only reads it and can be done concurrently.
+	 */
+	class Patterns {
+		struct Node {
+			std::array<std::uint32_t, 256> next{}; /**< Complete transitions */
+			std::int32_t match = -1;    /**< Pattern ending here          */
+			std::uint32_t dict = 0;     /**< Next suffix with a match     */
+		};
+		std::vector<Node> nodes;        /**< Node 0 is the root           */
+		std::vector<std::string> strings;
+
+	public:
+		/**
+		 * A pattern found in a text: its index and its start offset.
+		 */
+		struct Hit {
+			std::size_t pattern;
+			std::size_t offset;
+		};
+
+		Patterns(std::initializer_list<std::string> list) :
+			Patterns(std::vector<std::string>(list)) { }
+
+		Patterns(const std::vector<std::string>& list) : strings(list) {
+			/* Build the trie. Zero means "no edge" since no edge leads
+			 * back to the root. */
+			nodes.emplace_back();
+			for (std::size_t i = 0; i < strings.size(); ++i) {
+				if (strings[i].empty())
+					continue;
+				std::uint32_t v = 0;
+				for (unsigned char c : strings[i]) {
+					if (nodes[v].next[c] == 0) {
+						nodes[v].next[c] = nodes.size();
+						nodes.emplace_back();
+					}
+					v = nodes[v].next[c];
+				}
+				if (nodes[v].match < 0)
+					nodes[v].match = i;
+			}
+
+			/* Compute failure links breadth-first and turn the trie into
+			 * a complete automaton by filling in the missing transitions.
+			 * `dict` links skip to the longest proper suffix which ends
+			 * a pattern. */
+			std::vector<std::uint32_t> fail(nodes.size(), 0);
+			std::vector<std::uint32_t> queue;
+			for (unsigned int c = 0; c < 256; ++c) {
+				if (nodes[0].next[c] != 0)
+					queue.push_back(nodes[0].next[c]);
+			}
+			for (std::size_t head = 0; head < queue.size(); ++head) {
+				std::uint32_t v = queue[head];
+				std::uint32_t f = fail[v];
+				nodes[v].dict = nodes[f].match >= 0 ? f : nodes[f].dict;
+				for (unsigned int c = 0; c < 256; ++c) {
+					std::uint32_t w = nodes[v].next[c];
+					if (w != 0) {
+						fail[w] = nodes[f].next[c];
+						queue.push_back(w);
+					}
+					else {
+						nodes[v].next[c] = nodes[f].next[c];
+					}
+				}
+			}
+		}
+
+		std::size_t size(void) const {
+			return strings.size();
+		}
+
+		const std::string& operator[](std::size_t i) const {
+			return strings[i];
+		}
+
+		/**
+		 * Scan `text` and call `f(hit)` for every occurrence of every
+		 * pattern in order of their end positions. Scanning stops when
+		 * `f` returns false.
+		 */
+		template<typename F>
+		void scan(std::string_view text, F&& f) const {
+			std::uint32_t v = 0;
+			for (std::size_t i = 0; i < text.size(); ++i) {
+				v = nodes[v].next[static_cast<unsigned char>(text[i])];
+				for (std::uint32_t w = nodes[v].match >= 0 ? v : nodes[v].dict; w != 0; w = nodes[w].dict) {
+					std::size_t p = nodes[w].match;
+					if (not f(Hit{ p, i + 1 - strings[p].size() }))
+						return;
+				}
+			}
+		}
+	};
+
+	/**
+	 * Policies which configure a BasicContext at compile time. The
+	 * code for what a configuration leaves out is not generated.
+	 */
+	namespace Policy {
+		/**
+		 * Sink policy: write TAP to the output device and flush it
+		 * after every test line.
+		 */
+		struct Unbuffered {
+			static constexpr bool output = true;
+			static constexpr bool flush  = true;
+		};
+
+		/**
+		 * Sink policy: write TAP to the output device but leave
+		 * flushing to the stream.
+		 */
+		struct Buffered {
+			static constexpr bool output = true;
+			static constexpr bool flush  = false;
+		};
+
+		/**
+		 * Sink policy: write nothing but "Bail out!", only count.
+		 */
+		struct Quiet {
+			static constexpr bool output = false;
+			static constexpr bool flush  = false;
+		};
+
+		/**
+		 * Threading policy: counters can be read by other threads,
+		 * see `stats`, and fixtures are guarded by a mutex.
+		 */
+		struct Threaded {
+			template<typename T>
+			using counter = std::atomic<T>;
+			using mutex = std::mutex;
+		};
+
+		/**
+		 * A counter with the part of the interface of std::atomic
+		 * which BasicContext uses, but without synchronization.
+		 */
+		template<typename T>
+		class Plain {
+			T value;
+
+		public:
+			Plain(T x = T()) : value(x) { }
+			Plain& operator=(T x) { value = x; return *this; }
+			operator T(void) const { return value; }
+			T load(std::memory_order = std::memory_order_seq_cst) const { return value; }
+			T fetch_add(T n, std::memory_order = std::memory_order_seq_cst) { T old = value; value += n; return old; }
+			T operator++(void) { return ++value; }
+			T operator+=(T n) { return value += n; }
+		};
+
+		/**
+		 * A mutex which does nothing.
+		 */
+		struct NoMutex {
+			void lock(void) { }
+			void unlock(void) { }
+		};
+
+		/**
+		 * Threading policy: plain counters for contexts which are only
+		 * used by one thread. There are no thread subtests, because
+		 * they would update the counters and fixtures of the root
+		 * concurrently, and `stats` and `heartbeat` are not thread-safe.
+		 */
+		struct SingleThreaded {
+			template<typename T>
+			using counter = Plain<T>;
+			using mutex = NoMutex;
+		};
+
+		/**
+		 * Report policy: comments (`note` and `diag`, including the
+		 * diagnostics of failed tests) and timing of subtests.
+		 */
+		struct Full {
+			static constexpr bool comments = true;
+			static constexpr bool timing   = true;
+		};
+
+		/**
+		 * Report policy: only test and plan lines.
+		 */
+		struct TapOnly {
+			static constexpr bool comments = false;
+			static constexpr bool timing   = false;
+		};
+	}
+
+	/**
+	 * A Context holds a TAP producer's state, including the test
+	 * plan, the test numbering, output stream and TODO directives.
+	 * Its methods update the state and print TAP directly to the
+	 * output device. What it does beyond the basics is configured by
+	 * the policies in TAP::Policy; `Context` is the fully featured
+	 * configuration.
+	 */
+	template<typename Sink, typename Threading, typename Report>
+	class BasicContext {
+		std::ostream& out = std::cout;  /**< Output device     */
+		/* Counters are atomic so that `stats` can read them anytime */
+		template<typename T>
+		using counter = typename Threading::template counter<T>;
+		counter<unsigned int> planned{0}; /**< Number of planned tests */
+		counter<unsigned int> run{0};     /**< Number of run tests     */
+		counter<unsigned int> good{0};    /**< Number of "ok" tests    */
+		counter<unsigned int> bad{0};     /**< Number of "not ok" tests */
+		counter<unsigned int> todos{0};   /**< Number of failed TODOs  */
+		counter<unsigned int> skipped{0}; /**< Number of skipped tests */
+		std::string  todo   = ""; /**< Next test's TODO        */
+		unsigned int todo_left = 0; /**< Tests left in a TODO range */
+
+		bool have_plan = false; /**< Whether a plan line was printed */
+		bool finished  = false; /**< Whether done_testing was called */
+
+		unsigned int depth       = 0; /**< Subtest depth       */
+		std::string description = ""; /**< Subtest description */
+		std::string directive = "";   /**< Appended to its summary line */
+		BasicContext* parent = nullptr;    /**< Parent in the subtest stack */
+		BasicContext* root = this;         /**< Top of the subtest stack    */
+		counter<std::uint64_t> asserted{0}; /**< Assertions in all subtests, at the root */
+		std::ostream* diag_out = nullptr; /**< Diagnostics sink or `out` */
+		bool diag_flush = true;           /**< Flush the sink per message  */
+
+		/* Progress journal of top-level subtests, see `journal` */
+		int journal_fd = -1;          /**< Journal file descriptor     */
+		std::string journal_path;     /**< Journal file name           */
+		struct Entry {
+			bool is_ok;
+			std::string message;
+			std::uint64_t offset;     /**< Where it starts in the file */
+		};
+		std::vector<Entry> replay;    /**< Resumable subtests          */
+		std::size_t subtests = 0;     /**< Number of derived subtests  */
+		bool is_resumed = false;      /**< Whether replayed from journal */
+		bool replayed_ok = false;     /**< Replayed result             */
+
+		/**
+		 * A subtest handed to a worker thread, with its private buffers
+		 * for the TAP stream and, if there is a sink, for diagnostics.
+		 */
+		struct Detached {
+			std::unique_ptr<std::ostringstream> buffer;
+			std::unique_ptr<BasicContext> ctx;
+			std::unique_ptr<std::ostringstream> diag_buffer;
+		};
+		std::vector<Detached> detached; /**< Unmerged thread subtests  */
+		bool is_detached = false;     /**< Whether merged by the parent */
+
+		/**
+		 * Running time of a finished subtest. CPU time is only measured
+		 * for thread subtests and negative otherwise.
+		 */
+		struct Timing {
+			std::string path;
+			std::chrono::steady_clock::duration wall;
+			double cpu;
+		};
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::duration elapsed{0}; /**< Wall time when done */
+		double cpu_started = -1;      /**< Thread CPU time at first test */
+		double cpu         = -1;      /**< Thread CPU time used when done */
+		unsigned int slowest_n = 0;   /**< Size of the slowest report    */
+		std::vector<Timing> slowest_heap; /**< Min-heap of slowest ones */
+
+		/**
+		 * Thread printing progress reports, see `heartbeat`.
+		 */
+		struct Heartbeat {
+			std::thread thread;
+			std::mutex mtx;
+			std::condition_variable cv;
+			bool stop = false;
+		};
+		std::unique_ptr<Heartbeat> beat;
+
+		/**
+		 * A lazily constructed fixture, see `fixture`. Only the
+		 * top-level context keeps fixtures.
+		 */
+		struct Fixture {
+			const std::type_info* type;
+			std::string name;
+			std::once_flag once;
+			std::shared_ptr<const void> value;
+		};
+		typename Threading::mutex fixtures_mtx; /**< Guards the fixtures list */
+		std::vector<std::unique_ptr<Fixture>> fixtures;
+
+		friend class Endurance;
+		friend class Suite;
+
+		/**
+		 * Diagnose pattern hits in `text` in the order of their offsets,
+		 * with line numbers and an excerpt of the line.
+		 */
+		void diag_hits(std::string_view text, const Patterns& patterns, std::vector<Patterns::Hit> hits) {
+			std::sort(hits.begin(), hits.end(),
+			    [] (const Patterns::Hit& a, const Patterns::Hit& b) { return a.offset < b.offset; });
+			std::size_t line_no = 1, counted = 0;
+			for (const auto& h : hits) {
+				line_no += std::count(text.begin() + counted, text.begin() + h.offset, '\n');
+				counted = h.offset;
+				std::size_t bol = text.rfind('\n', h.offset);
+				bol = bol == std::string_view::npos ? 0 : bol + 1;
+				std::size_t eol = text.find('\n', h.offset);
+				std::string_view excerpt = text.substr(bol, eol == std::string_view::npos ? eol : eol - bol);
+				if (excerpt.size() > 80)
+					excerpt = text.substr(std::max(bol, h.offset > 30 ? h.offset - 30 : 0), 80);
+				diag("'", patterns[h.pattern], "' at offset ", h.offset,
+				    " (line ", line_no, "): ", excerpt);
+			}
+		}
+
+		/**
+		 * Increment a decimal number kept as ASCII digits.
+		 */
+		static void increment(std::string& digits) {
+			for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+				if (*it != '9') {
+					++*it;
+					return;
+				}
+				*it = '0';
+			}
+			digits.insert(digits.begin(), '1');
+		}
+
+		/**
+		 * Consume the TODO of the current test. The TODO stays for the
+		 * next test while a range set by `TODO(how_many, reason)` lasts.
+		 */
+		void todo_used(void) {
+			if (todo_left > 1) {
+				--todo_left;
+				return;
+			}
+			todo.clear();
+			todo_left = 0;
+		}
+
+		/**
+		 * Write the lines of `SKIP(how_many, reason)` in one go,
+		 * counting up the test number and the counter in place, in
+		 * large blocks.
+		 */
+		void write_skips(unsigned int how_many, const std::string& reason) {
+			const std::string indent(4 * depth, ' ');
+			const std::string directive = " - # SKIP " + (reason.empty() ? "" : reason + " ");
+			const std::string total = "/" + std::to_string(how_many);
+			std::string number = std::to_string(run);
+			std::string current = "0";
+			std::string block;
+			block.reserve(1 << 16);
+			for (unsigned int i = 0; i < how_many; ++i) {
+				increment(number);
+				increment(current);
+				block += indent;
+				block += "ok ";
+				block += number;
+				block += directive;
+				block += current;
+				block += total;
+				if (not todo.empty()) {
+					block += " # TODO " + todo;
+					todo_used();
+				}
+				block += '\n';
+				if (block.size() >= (1 << 16) - 256) {
+					out.write(block.data(), block.size());
+					block.clear();
+				}
+			}
+			out.write(block.data(), block.size());
+			if constexpr (Sink::flush)
+				out.flush();
+		}
+
+		/**
+		 * Return `out` but apply `depth` indentation first.
+		 */
+		std::ostream& line(void) {
+			for (unsigned int i = 0; i < depth; ++i)
+				out << "    ";
+			return out;
+		}
+
+		/**
+		 * Create a subtest. If its result is available for replay from
+		 * the journal, it is reported immediately and the subtest is
+		 * returned finished and marked as resumed.
+		 */
+		BasicContext* derive(const std::string& message) {
+			auto sub = std::make_unique<BasicContext>(out);
+			sub->depth = depth + 1;
+			sub->description = message;
+			sub->parent = this;
+			sub->slowest_n = slowest_n;
+			sub->diag_out = diag_out;
+			sub->diag_flush = diag_flush;
+			sub->root = root;
+
+			if (resume(*sub)) {
+				if constexpr (Sink::output)
+					sub->line() << "# resumed from journal" << std::endl;
+				ok(sub->replayed_ok, message);
+			}
+			return sub.release();
+		}
+
+		/**
+		 * Count `sub` as the next subtest of this context and mark it
+		 * resumed if the journal has its result. When the journal
+		 * diverges from this run, the rest of it is discarded.
+		 */
+		bool resume(BasicContext& sub) {
+			std::size_t k = subtests++;
+			if (k >= replay.size())
+				return false;
+			if (replay[k].message != sub.description) {
+#ifdef TAPPP_POSIX
+				if (journal_fd >= 0 and ::ftruncate(journal_fd, replay[k].offset) < 0) {
+					::close(journal_fd);
+					journal_fd = -1;
+				}
+#endif
+				replay.clear();
+				return false;
+			}
+			sub.is_resumed = true;
+			sub.finished = true;
+			sub.replayed_ok = replay[k].is_ok;
+			return true;
+		}
+
+		/**
+		 * Escape a subtest description for the line-based journal.
+		 */
+		static std::string escape(const std::string& message) {
+			std::string escaped;
+			for (char c : message) {
+				switch (c) {
+				case '\\': escaped += "\\\\"; break;
+				case '\t': escaped += "\\t"; break;
+				case '\n': escaped += "\\n"; break;
+				case '\r': escaped += "\\r"; break;
+				default:   escaped += c;
+				}
+			}
+			return escaped;
+		}
+
+		/**
+		 * Undo `escape`.
+		 */
+		static std::string unescape(const std::string& escaped) {
+			std::string message;
+			for (std::size_t i = 0; i < escaped.size(); ++i) {
+				char c = escaped[i];
+				if (c == '\\' and i + 1 < escaped.size()) {
+					switch (escaped[++i]) {
+					case 't': c = '\t'; break;
+					case 'n': c = '\n'; break;
+					case 'r': c = '\r'; break;
+					default:  c = escaped[i];
+					}
+				}
+				message += c;
+			}
+			return message;
+		}
+
+		/**
+		 * CPU time consumed by the calling thread in seconds, or
+		 * a negative number if it cannot be determined.
+		 */
+		static double thread_cpu(void) {
+#ifdef TAPPP_POSIX
+			struct timespec ts;
+			if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+				return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+			return -1;
+		}
+
+		/**
+		 * Offer a subtest timing for the slowest subtests report.
+		 * Timings travel up to the top-level context, except that
+		 * thread subtests keep them until they are merged, so that
+		 * worker threads never touch their parents.
+		 */
+		void timed(Timing t) {
+			if (parent and not is_detached)
+				return parent->timed(std::move(t));
+			if (slowest_n == 0)
+				return;
+			auto longer = [] (const Timing& a, const Timing& b) { return a.wall > b.wall; };
+			if (slowest_heap.size() < slowest_n) {
+				slowest_heap.push_back(std::move(t));
+				std::push_heap(slowest_heap.begin(), slowest_heap.end(), longer);
+			}
+			else if (t.wall > slowest_heap.front().wall) {
+				std::pop_heap(slowest_heap.begin(), slowest_heap.end(), longer);
+				slowest_heap.back() = std::move(t);
+				std::push_heap(slowest_heap.begin(), slowest_heap.end(), longer);
+			}
+		}
+
+		/**
+		 * Print the slowest subtests report of a top-level context.
+		 */
+		void report_slowest(void) {
+			if (slowest_heap.empty())
+				return;
+			auto total = std::chrono::duration<double>(elapsed).count();
+			std::sort(slowest_heap.begin(), slowest_heap.end(),
+			    [] (const Timing& a, const Timing& b) { return a.wall > b.wall; });
+			diag("slowest ", slowest_heap.size(), " subtests:");
+			for (const auto& t : slowest_heap) {
+				auto wall = std::chrono::duration<double>(t.wall).count();
+				std::stringstream ss;
+				ss << std::fixed << std::setprecision(3) << wall << "s "
+				   << std::setprecision(1) << std::setw(5)
+				   << (total > 0 ? 100 * wall / total : 0) << "%  " << t.path;
+				if (t.cpu >= 0)
+					ss << std::setprecision(3) << " (cpu " << t.cpu << "s)";
+				diag("  ", ss.str());
+			}
+			slowest_heap.clear();
+		}
+
+		/**
+		 * Description of this subtest including those of its parents.
+		 */
+		std::string path(void) const {
+			if (not parent or parent->description.empty())
+				return description;
+			return parent->path() + " / " + description;
+		}
+
+		/**
+		 * Run `f` on the subtest `sub` and take care of its lifetime.
+		 */
+		static bool scoped(BasicContext* sub, const std::function<void(BasicContext&)>& f) {
+			std::unique_ptr<BasicContext> guard(sub);
+			if (sub->resumed())
+				return sub->summary();
+			try {
+				f(*sub);
+			}
+			catch (const X::Required& e) {
+				sub->skip_rest("required test failed");
+			}
+			bool is_ok = sub->summary();
+			if (not sub->finished)
+				sub->done_testing();
+			return is_ok;
+		}
+
+		/**
+		 * One line of progress report for `heartbeat`.
+		 */
+		std::string progress(void) const {
+			Stats st = stats();
+			std::ostringstream line;
+			line << std::fixed << std::setprecision(1) << "# progress: " << st.run;
+			if (st.planned)
+				line << "/" << st.planned;
+			line << " tests, " << st.failed << " failed, " << st.skipped << " skipped, "
+			     << st.assertions << " assertions at " << st.rate << "/s, "
+			     << st.elapsed << "s elapsed";
+			if (st.planned > st.run and st.run > 0)
+				line << ", ETA " << st.elapsed * (st.planned - st.run) / st.run << "s";
+			line << "\n";
+			return line.str();
+		}
+
+		/**
+		 * Stop the heartbeat thread, if there is one.
+		 */
+		void stop_heartbeat(void) {
+			if (not beat)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(beat->mtx);
+				beat->stop = true;
+			}
+			beat->cv.notify_all();
+			beat->thread.join();
+			beat.reset();
+		}
+
+		/**
+		 * Report the summary of this subtest to its parent, unless it
+		 * is a thread subtest, which `merge` reports. The journal gets
+		 * the description without the directive, which is how the
+		 * subtest is looked up when resuming.
+		 */
+		void report(void) {
+			if (parent and not is_detached) {
+				parent->ok(summary(), description + directive);
+				parent->record(summary(), description);
+			}
+		}
+
+		/**
+		 * Append a finished subtest's result to the journal and make
+		 * sure it reaches the disk.
+		 */
+		void record(bool is_ok, const std::string& message) {
+#ifdef TAPPP_POSIX
+			if (journal_fd < 0)
+				return;
+			std::string entry = (is_ok ? "ok\t" : "not ok\t") + escape(message) + "\n";
+			if (::write(journal_fd, entry.data(), entry.size()) >= 0)
+				::fsync(journal_fd);
+#endif
+		}
+
+	public:
+
+		/**
+		 * Create a new empty Context object. The default output device
+		 * is std::cout. No plan line is printed. You either have to call
+		 * `plan` before any tests or `done_testing` after the last one.
+		 */
+		BasicContext(std::ostream& out = std::cout) : out(out) { }
+
+		/**
+		 * Create a new Context object and print a plan line.
+		 */
+		BasicContext(unsigned int tests, std::ostream& out = std::cout) : out(out) {
+			plan(tests);
+		}
+
+		/**
+		 * Create a new Context and skip it entirely. The `1..0` plan
+		 * line is printed and the context is marked as finished.
+		 */
+		BasicContext(const skip_all& skip [[maybe_unused]], const std::string& reason = "", std::ostream& out = std::cout) : out(out) {
+			plan(skip, reason);
+		}
+
+		/**
+		 * Unless already done, close this TAP session.
+		 */
+		~BasicContext(void) {
+			stop_heartbeat();
+			if (not finished)
+				done_testing();
+#ifdef TAPPP_POSIX
+			if (journal_fd >= 0)
+				::close(journal_fd);
+#endif
+		}
+
+		/**
+		 * Create a new subtest off this one. The subtest uses the
+		 * same output device but indents its output, so that subtest-
+		 * unaware harnesses ignore it. When the subtest is destroyed,
+		 * it adds a single summary `pass` or `fail` to the test it
+		 * was created from. The user is responsible for keeping the
+		 * parent context alive.
+		 */
+		BasicContext* subtest(const std::string& message = "") {
+			return derive(message);
+		}
+
+		/**
+		 * Like `subtest(message)` but already print a plan line.
+		 */
+		BasicContext* subtest(unsigned int tests, const std::string& message = "") {
+			BasicContext* sub = derive(message);
+			if (not sub->resumed())
+				sub->plan(tests);
+			return sub;
+		}
+
+		/**
+		 * Run `f` on a new subtest and finish it afterwards. A failed
+		 * `require` in `f` ends the subtest early; the remaining tests
+		 * of its plan are skipped. Returns the subtest's summary.
+		 */
+		bool subtest(const std::string& message, std::function<void(BasicContext&)> f) {
+			return scoped(derive(message), f);
+		}
+
+		/**
+		 * Like `subtest(message, f)` but already print a plan line.
+		 */
+		bool subtest(unsigned int tests, const std::string& message, std::function<void(BasicContext&)> f) {
+			return scoped(subtest(tests, message), f);
+		}
+
+		/**
+		 * Create a subtest for a worker thread. It shares no state with
+		 * this context or other subtests: its output and diagnostics go
+		 * to private buffers and it does not report to the parent when
+		 * it is done.
+		 * Instead, `merge` appends the output and summaries of all thread
+		 * subtests to this context in the order they were created, which
+		 * makes the result independent of thread scheduling. Call this
+		 * method from the parent's thread. The subtest is owned by this
+		 * context and destroyed by `merge`. Like other subtests, it may
+		 * be resumed from the journal, in which case it is finished
+		 * already and the worker should leave it alone.
+		 */
+		BasicContext* thread_subtest(const std::string& message = "") {
+			static_assert(std::is_same_v<Threading, Policy::Threaded>,
+			    "thread subtests update the root's counters from their threads");
+			auto buffer = std::make_unique<std::ostringstream>();
+			auto sub = std::make_unique<BasicContext>(*buffer);
+			std::unique_ptr<std::ostringstream> diag_buffer;
+			if (diag_out)
+				diag_buffer = std::make_unique<std::ostringstream>();
+			sub->depth = depth + 1;
+			sub->description = message;
+			sub->parent = this;
+			sub->slowest_n = slowest_n;
+			sub->diag_out = diag_buffer.get();
+			sub->diag_flush = false;
+			sub->root = root;
+			sub->is_detached = true;
+			if (resume(*sub)) {
+				if constexpr (Sink::output)
+					sub->line() << "# resumed from journal" << std::endl;
+			}
+			detached.push_back({ std::move(buffer), std::move(sub), std::move(diag_buffer) });
+			return detached.back().ctx.get();
+		}
+
+		/**
+		 * Merge all thread subtests into this context after the worker
+		 * threads have joined. Each one's buffered output is printed,
+		 * followed by its summary line, in the order of creation, and
+		 * its buffered diagnostics are written to the sink.
+		 * Unfinished thread subtests are finished first.
+		 */
+		void merge(void) {
+			merge(detached.size());
+		}
+
+		/**
+		 * Like `merge()` but only merge the `how_many` thread subtests
+		 * which were created first. The caller must make sure that their
+		 * workers are done with them.
+		 */
+		void merge(std::size_t how_many) {
+			how_many = std::min(how_many, detached.size());
+			for (std::size_t i = 0; i < how_many; ++i) {
+				auto& d = detached[i];
+				if (not d.ctx->finished)
+					d.ctx->done_testing();
+				out << d.buffer->str() << std::flush;
+				if (d.diag_buffer and diag_out) {
+					*diag_out << d.diag_buffer->str();
+					if (diag_flush)
+						diag_out->flush();
+				}
+				ok(d.ctx->summary(), d.ctx->description + d.ctx->directive);
+				if (not d.ctx->resumed())
+					record(d.ctx->summary(), d.ctx->description);
+				if (slowest_n > 0) {
+					timed({ d.ctx->path(), d.ctx->elapsed, d.ctx->cpu });
+					for (auto& t : d.ctx->slowest_heap)
+						timed(std::move(t));
+				}
+			}
+			detached.erase(detached.begin(), detached.begin() + how_many);
+		}
+
+		/**
+		 * The cost tier of this test run, taken from the environment
+		 * variable TAPPP_TIER: `smoke`, `full` (the default) or
+		 * `exhaustive`.
+		 */
+		static Tier tier(void) {
+			const char* name = std::getenv("TAPPP_TIER");
+			std::string t = name ? name : "";
+			if (t == "smoke")
+				return Tier::smoke;
+			if (t == "exhaustive")
+				return Tier::exhaustive;
+			return Tier::full;
+		}
+
+		/**
+		 * Whether informational diagnostics, which are not about a
+		 * failure, are wanted: the environment variable TAPPP_VERBOSE
+		 * is set to something other than empty or `0`.
+		 */
+		static bool verbose(void) {
+			const char* v = std::getenv("TAPPP_VERBOSE");
+			return v and *v and std::string(v) != "0";
+		}
+
+		/**
+		 * Whether tests of the given cost tier run in this test run.
+		 * If not, `how_many` tests are skipped and false is returned,
+		 * so that the tests can be guarded by an `if`.
+		 */
+		bool within_tier(Tier cost, unsigned int how_many = 1) {
+			if (cost <= tier())
+				return true;
+			SKIP(how_many, cost == Tier::full ? "full tier" : "exhaustive tier");
+			return false;
+		}
+
+		/**
+		 * A deterministic sample of iterations, see `sampled`.
+		 */
+		class Sample {
+			BasicContext& ctx;
+			double rate;
+			std::uint64_t seed;
+			std::uint64_t threshold;   /**< Hashes below are sampled */
+			bool all;                  /**< Whether to take every one */
+			std::uint64_t index = 0;   /**< Next iteration            */
+			std::uint64_t taken = 0;   /**< Iterations sampled        */
+
+			/**
+			 * The rate to sample at: `rate` clamped to [0, 1], and a
+			 * tenth of it in the smoke tier unless it is 1. A rate which
+			 * is not finite is rejected with std::invalid_argument.
+			 */
+			static double effective(double rate) {
+				if (not std::isfinite(rate))
+					throw std::invalid_argument("sampling rate is not finite: " + std::to_string(rate));
+				rate = std::clamp(rate, 0.0, 1.0);
+				if (rate < 1 and BasicContext::tier() == Tier::smoke)
+					rate /= 10;
+				return rate;
+			}
+
+		public:
+			Sample(BasicContext& ctx, double rate, std::uint64_t seed) :
+				ctx(ctx), rate(effective(rate)), seed(seed),
+				threshold(this->rate >= 1 ? std::numeric_limits<std::uint64_t>::max() :
+				    static_cast<std::uint64_t>(std::ldexp(this->rate, 64))),
+				all(this->rate >= 1 or BasicContext::tier() == Tier::exhaustive)
+			{ }
+
+			Sample(const Sample&) = delete;
+
+			/**
+			 * Record the sampling rate, seed and outcome in the TAP.
+			 */
+			~Sample(void) {
+				if (ctx.finished)
+					return;
+				if (all)
+					ctx.note("sampled all ", index, " iterations");
+				else
+					ctx.note("sampled ", taken, " of ", index, " iterations at rate ", rate, ", seed ", seed);
+			}
+
+			/**
+			 * Whether the iteration `i` belongs to the sample. This only
+			 * depends on `i`, the rate and the seed.
+			 */
+			bool contains(std::uint64_t i) const {
+				return all or mix64(seed ^ mix64(i)) < threshold;
+			}
+
+			/**
+			 * Advance to the next iteration and return whether it
+			 * belongs to the sample.
+			 */
+			bool operator()(void) {
+				bool in = contains(index++);
+				taken += in;
+				return in;
+			}
+		};
+
+		/**
+		 * Start a deterministic sample of the following iterations, to
+		 * guard expensive checks. Each call of the returned object
+		 * advances to the next iteration and says whether to check it.
+		 * About a fraction `rate` of iterations is sampled, always the
+		 * same ones for the same seed and tier; in the smoke tier, a
+		 * tenth as many unless `rate` is 1, and in the exhaustive tier,
+		 * every iteration. When the object goes out of scope, the rate,
+		 * the seed and the number of sampled iterations are noted.
+		 * Throws std::invalid_argument if `rate` is NaN or infinite.
+		 */
+		Sample sampled(double rate, std::uint64_t seed = 0) {
+			return Sample(*this, rate, seed);
+		}
+
+		/**
+		 * Return the fixture of type T with the given name, shared by
+		 * all subtests of the top-level context, including thread
+		 * subtests. It is constructed from the return value of `factory`
+		 * on first use, exactly once even if subtests on several threads
+		 * ask for it at the same time, and the time this took is printed
+		 * as diagnostics. If `factory` throws, the next use tries again.
+		 * The fixture is destroyed when the top-level context is done
+		 * testing.
+		 */
+		template<typename T, typename F>
+		const T& fixture(const std::string& name, F factory) {
+			Fixture* f = nullptr;
+			{
+				std::lock_guard<typename Threading::mutex> lock(root->fixtures_mtx);
+				for (auto& known : root->fixtures) {
+					if (*known->type == typeid(T) and known->name == name)
+						f = known.get();
+				}
+				if (not f) {
+					root->fixtures.push_back(std::make_unique<Fixture>());
+					f = root->fixtures.back().get();
+					f->type = &typeid(T);
+					f->name = name;
+				}
+			}
+			std::call_once(f->once, [&] {
+				auto start = std::chrono::steady_clock::now();
+				f->value = std::make_shared<const T>(factory());
+				diag("fixture ", name.empty() ? typeid(T).name() : name, " set up in ",
+				    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), "s");
+			});
+			return *static_cast<const T*>(f->value.get());
+		}
+
+		/**
+		 * Like `fixture(name, factory)` for the unnamed fixture of type T.
+		 */
+		template<typename T, typename F>
+		const T& fixture(F factory) {
+			return fixture<T>("", std::move(factory));
+		}
+
+		/**
+		 * Snapshot of the progress of a context, see `stats`.
+		 */
+		struct Stats {
+			unsigned int planned;     /**< Planned tests, 0 without plan */
+			unsigned int run;         /**< Tests run                     */
+			unsigned int passed;      /**< Tests passed, with skipped    */
+			unsigned int failed;      /**< Tests failed, with TODO       */
+			unsigned int todo;        /**< Failed TODO tests             */
+			unsigned int skipped;     /**< Skipped tests                 */
+			std::uint64_t assertions; /**< Assertions in all subtests    */
+			double elapsed;           /**< Seconds since creation        */
+			double rate;              /**< Assertions per second         */
+		};
+
+		/**
+		 * Take a snapshot of the counters of this context. It only
+		 * reads atomic counters and may be called from any thread while
+		 * tests are running. Tests in subtests count as one test of this
+		 * context, but as separate assertions.
+		 *
+		 * A test is counted in `run` before it is counted as passed or
+		 * failed. Reading those two first, with acquire ordering, makes
+		 * `passed + failed <= run` hold: a test in flight is only run.
+		 */
+		Stats stats(void) const {
+			Stats st;
+			st.passed     = good.load(std::memory_order_acquire);
+			st.failed     = bad.load(std::memory_order_acquire);
+			st.run        = run.load(std::memory_order_relaxed);
+			st.planned    = planned.load(std::memory_order_relaxed);
+			st.todo       = todos.load(std::memory_order_relaxed);
+			st.skipped    = skipped.load(std::memory_order_relaxed);
+			st.assertions = root->asserted.load(std::memory_order_relaxed);
+			st.elapsed    = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+			st.rate       = st.elapsed > 0 ? st.assertions / st.elapsed : 0;
+			return st;
+		}
+
+		/**
+		 * Start a thread which writes a one-line progress report built
+		 * from `stats`, with an estimate of the remaining time if there
+		 * is a plan, every `period` until this context is done testing.
+		 * The report goes to std::cerr, or replaces the contents of the
+		 * file `status` if given. It never touches the TAP stream.
+		 * A zero period stops the heartbeat.
+		 */
+		void heartbeat(std::chrono::milliseconds period, const std::string& status = "") {
+			static_assert(std::is_same_v<Threading, Policy::Threaded>,
+			    "heartbeat reads the counters from another thread");
+			stop_heartbeat();
+			if (period.count() <= 0)
+				return;
+			beat = std::make_unique<Heartbeat>();
+			beat->thread = std::thread([this, period, status, hb = beat.get()] {
+				std::unique_lock<std::mutex> lock(hb->mtx);
+				while (not hb->cv.wait_for(lock, period, [&] { return hb->stop; })) {
+					std::string report = progress();
+					if (status.empty()) {
+						std::cerr << report << std::flush;
+						continue;
+					}
+					/* Replace the file at once for readers polling it */
+					std::string tmp = status + ".tmp";
+					std::ofstream(tmp) << report;
+					std::rename(tmp.c_str(), status.c_str());
+				}
+			});
+		}
+
+		/**
+		 * Track the wall time of subtests (and the CPU time of thread
+		 * subtests) and print the `n` slowest ones with their share of
+		 * the total running time when this context is done testing.
+		 * Only subtests derived after this call are tracked. Zero
+		 * disables the report.
+		 */
+		void slowest(unsigned int n) {
+			slowest_n = n;
+		}
+
+		/**
+		 * Whether this subtest was not run but its result replayed
+		 * from the parent's journal.
+		 */
+		bool resumed(void) const {
+			return is_resumed;
+		}
+
+#ifdef TAPPP_POSIX
+		/**
+		 * Keep a progress journal of the subtests of this context in
+		 * the file `path`. The result of every finished subtest is
+		 * appended to the file and synced to disk. If `resume` is
+		 * true, the journal of an interrupted run is read first: the
+		 * results of subtests recorded in it are replayed instead of
+		 * running the subtests again, as long as their descriptions
+		 * match. The journal is kept and only new results are appended,
+		 * so a resumed run can be interrupted and resumed again. When
+		 * this context is done testing, the journal is removed.
+		 */
+		void journal(const std::string& path, bool resume = false) {
+			replay.clear();
+			std::uint64_t valid = 0;  /**< End of the last complete entry */
+			if (resume) {
+				std::ifstream in(path);
+				for (std::string entry; std::getline(in, entry) and not in.eof(); ) {
+					auto tab = entry.find('\t');
+					std::string status = entry.substr(0, tab);
+					if (tab == std::string::npos or (status != "ok" and status != "not ok"))
+						break;
+					replay.push_back({ status == "ok", unescape(entry.substr(tab + 1)), valid });
+					valid += entry.size() + 1;
+				}
+			}
+			if (journal_fd >= 0)
+				::close(journal_fd);
+			journal_path = path;
+			journal_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (resume ? 0 : O_TRUNC), 0644);
+			/* Drop a torn entry from a crash in the middle of a write */
+			if (journal_fd >= 0 and resume and ::ftruncate(journal_fd, valid) < 0) {
+				::close(journal_fd);
+				journal_fd = -1;
+			}
+		}
+#endif
+
+		/**
+		 * Set up a test plan and emit the plan line.
+		 */
+		void plan(unsigned int tests) {
+			if (have_plan)
+				throw TAP::X::Planned();
+			if (finished)
+				throw TAP::X::Finished();
+
+			if (run > 0)
+				throw TAP::X::LatePlan();
+
+			if constexpr (Sink::output)
+				line() << "1.." << tests << std::endl;
+			planned = tests;
+			have_plan = true;
+		}
+
+		/**
+		 * Skip the entire test. Print the `1..0` plan line and then
+		 * mark the context as finished.
+		 */
+		void plan(const skip_all& skip [[maybe_unused]], const std::string& reason = "") {
+			if constexpr (Sink::output) {
+				line() << "1..0";
+				if (!reason.empty())
+					out << " # SKIP " << reason;
+				out << std::endl;
+			}
+			directive = " # SKIP" + (reason.empty() ? "" : " " + reason);
+			report();
+			finished = true;
+		}
+
+		/**
+		 * Return whether the whole session is good or not, taking into
+		 * account the test plan (if any) and the number of successful
+		 * vs. all run tests.
+		 */
+		bool summary(void) {
+			if (is_resumed)
+				return replayed_ok;
+			return good + todos == (have_plan ? planned : run);
+		}
+
+		/**
+		 * Close this TAP context from emitting further test lines.
+		 * If no test plan was printed in the beginning, it is done now.
+		 */
+		void done_testing(void) {
+			if (finished)
+				throw TAP::X::Finished();
+
+			merge();
+			stop_heartbeat();
+
+			/* Tear down fixtures in reverse order */
+			if (not parent) {
+				while (not fixtures.empty())
+					fixtures.pop_back();
+			}
+
+			if constexpr (Report::timing) {
+				elapsed = std::chrono::steady_clock::now() - started;
+				if (is_detached and cpu_started >= 0)
+					cpu = thread_cpu() - cpu_started;
+				if (slowest_n > 0) {
+					if (parent and not is_detached)
+						parent->timed({ path(), elapsed, -1 });
+					else if (not parent)
+						report_slowest();
+				}
+			}
+
+			if (!have_plan) {
+				if constexpr (Sink::output)
+					line() << "1.." << run << std::endl;
+			}
+			else {
+				if (planned != run) {
+					diag("Looks like you planned " + std::to_string(planned) +
+					    " tests but ran " + std::to_string(run));
+				}
+			}
+
+			report();
+
+#ifdef TAPPP_POSIX
+			/* A complete run needs no resuming */
+			if (journal_fd >= 0) {
+				::close(journal_fd);
+				journal_fd = -1;
+				::unlink(journal_path.c_str());
+			}
+#endif
+
+			finished = true;
+		}
+
+		/**
+		 * Write an "ok" or "not ok" line depending on the `is_ok`
+		 * argument.
+		 */
+		bool ok(bool is_ok, std::string_view message = "") {
+			if (finished)
+				throw TAP::X::Finished();
+			if constexpr (Report::timing) {
+				if (is_detached and cpu_started < 0)
+					cpu_started = thread_cpu();
+			}
+
+			root->asserted.fetch_add(1, std::memory_order_relaxed);
+			unsigned int number = ++run;
+			if constexpr (Sink::output) {
+				line() << (is_ok ? "ok " : "not ok ")
+				       << number << " - "
+				       << message;
+				if (!todo.empty()) {
+					out << (message.empty() ? "" : " ");
+					out << "# TODO " << todo;
+				}
+				out << '\n';
+				if constexpr (Sink::flush)
+					out.flush();
+			}
+			if (!todo.empty()) {
+				/* Count failed TODOs */
+				if (not is_ok)
+					++todos;
+				todo_used();
+			}
+
+			/* After `run`, see `stats` */
+			if (is_ok)
+				++good;
+			else
+				++bad;
+
+			return is_ok;
+		}
+
+		/**
+		 * Like `ok` but negates the bool first.
+		 */
+		bool nok(bool is_nok, std::string_view message = "") {
+			return ok(not is_nok, message);
+		}
+
+		/**
+		 * Pass a test unconditionally.
+		 */
+		bool pass(std::string_view message = "") {
+			return ok(true, message);
+		}
+
+		/**
+		 * Fail a test unconditionally.
+		 */
+		bool fail(std::string_view message = "") {
+			return ok(false, message);
+		}
+
+		/**
+		 * Mark the next test as "to-do". The next "ok" / "not ok"
+		 * line will be printed with the TODO directive, but only
+		 * if the reason string is non-empty.
+		 */
+		void TODO(const std::string& reason = "-") {
+			if (finished)
+				throw TAP::X::Finished();
+			todo = reason;
+			todo_left = 0;
+		}
+
+		/**
+		 * Mark the next `how_many` tests as "to-do" for the same reason.
+		 */
+		void TODO(unsigned int how_many, const std::string& reason = "-") {
+			TODO(how_many ? reason : "");
+			todo_left = how_many;
+		}
+
+		/**
+		 * Skip a test by emitting a `pass` with the SKIP directive.
+		 */
+		void SKIP(const std::string& reason = "") {
+			pass("# SKIP" + std::string(reason.empty() ? "" : " ") + reason);
+			++skipped;
+		}
+
+		/**
+		 * Skip the given number of tests by emitting `pass`es with
+		 * the SKIP directive. The reason is repeated for every `pass`
+		 * but a counter is added. The lines are formatted in one go.
+		 */
+		void SKIP(unsigned int how_many, const std::string& reason = "") {
+			if (finished)
+				throw TAP::X::Finished();
+			if constexpr (Report::timing) {
+				if (is_detached and cpu_started < 0)
+					cpu_started = thread_cpu();
+			}
+			if constexpr (Sink::output) {
+				write_skips(how_many, reason);
+			}
+			else {
+				for (unsigned int i = 0; i < how_many and not todo.empty(); ++i)
+					todo_used();
+			}
+			root->asserted.fetch_add(how_many, std::memory_order_relaxed);
+			run  += how_many;
+			good += how_many;
+			skipped += how_many;
+		}
+
+		/**
+		 * Skip all tests of the plan which have not been run yet.
+		 * Without a plan, there is nothing to do.
+		 */
+		void skip_rest(const std::string& reason = "") {
+			if (have_plan and run < planned)
+				SKIP(planned - run, reason);
+		}
+
+		/**
+		 * Like `ok` but a failure throws X::Required, which ends the
+		 * current subtest, if it was started by the functional variant
+		 * of `subtest` or by a Suite.
+		 */
+		bool require(bool is_ok, const std::string& message = "") {
+			if (not ok(is_ok, message))
+				throw TAP::X::Required(message);
+			return true;
+		}
+
+		/**
+		 * Like `is` but a failure throws X::Required.
+		 */
+		template<typename T, typename U, typename Matcher = Equal>
+		bool require_is(const T& got, const U& expected, const std::string& message = "", Matcher m = Matcher()) {
+			if (not is(got, expected, message, m))
+				throw TAP::X::Required(message);
+			return true;
+		}
+
+		/**
+		 * Print a "Bail out!" message but does not exit.
+		 * Clients should do that after calling this function
 		 * and performing appropriate cleanup.
 		 */
-		void BAIL(const std::string& reason = "") {
-			if (finished)
-				throw TAP::X::Finished();
+		void BAIL(const std::string& reason = "") {
+			if (finished)
+				throw TAP::X::Finished();
+
+			line() << "Bail out!";
+			if (!reason.empty())
+				out << " " << reason;
+			out << std::endl;
+
+			finished = true;
+		}
+
+		/**
+		 * Print a comment on the TAP stream.
+		 */
+		template<typename... Ts>
+		void note(Ts&&... values) {
+			if constexpr (Sink::output and Report::comments)
+				print(line() << "# ", std::forward<Ts>(values)...);
+		}
+
+		/**
+		 * Print a diagnostic message to the diagnostics sink. Without
+		 * one, this is the same as `note`. Otherwise the message is
+		 * formatted first and written to the sink at once. Thread
+		 * subtests write to a buffer of their own, which `merge` copies
+		 * to the sink, so they never share it between threads.
+		 */
+		template<typename... Ts>
+		void diag(Ts&&... values) {
+			if constexpr (not Report::comments)
+				return;
+			if (not diag_out)
+				return note(std::forward<Ts>(values)...);
+			std::ostringstream msg;
+			print(msg << std::string(4 * depth, ' ') << "# ", std::forward<Ts>(values)...);
+			*diag_out << msg.str();
+			if (diag_flush)
+				diag_out->flush();
+		}
+
+		/**
+		 * Send the messages of `diag` to `sink`, for example std::cerr,
+		 * instead of the TAP stream, or back to it if passed nullptr.
+		 * The sink is flushed after every message unless `flush` is
+		 * false. Subtests derived afterwards inherit the sink.
+		 */
+		void diagnostics(std::ostream* sink, bool flush = true) {
+			diag_out = sink;
+			diag_flush = flush;
+		}
+
+		/**
+		 * Check if the first argument equals the second. The meaning of
+		 * "equality" is dictated by the last argument, which defaults
+		 * to `Equal`. If the test fails and the two values can
+		 * be stringified by operator<<'ing them to a stringstream, then
+		 * the differing values are printed as diagnostics.
+		 */
+		template<typename T, typename U, typename Matcher = Equal>
+		bool is(const T& got, const U& expected, std::string_view message = "", Matcher m = Matcher()) {
+			bool is_ok = ok(m(got, expected), message);
+			if constexpr (Report::comments and Occult::Stringifiable<T>::value) {
+				if (!is_ok) {
+					if constexpr (Occult::Stringifiable<U>::value) {
+						diag("Expected: '" + to_string(expected) + "'");
+						diag("     Got: '" + to_string(got) + "'");
+					}
+					else {
+						diag("Got: '" + to_string(got) + "'");
+					}
+				}
+			}
+			return is_ok;
+		}
+
+		/**
+		 * Like `is` but negates the comparison.
+		 */
+		template<typename T, typename U, typename Matcher = Equal>
+		bool isnt(const T& got, const U& unexpected, std::string_view message = "", Matcher m = Matcher()) {
+			bool is_ok = nok(m(got, unexpected), message);
+			if constexpr (Report::comments and Occult::Stringifiable<T>::value) {
+				if (!is_ok)
+					diag("Got: '" + to_string(got) + "'");
+			}
+			return is_ok;
+		}
+
+		/**
+		 * Test the value against a predicate. Uses `is` internally, so on
+		 * failure a best effort is made to print the unexpected value.
+		 */
+		template<typename T>
+		bool like(const T& got, Predicate<T> p, const std::string& message = "") {
+			return is(got, p, message, PredicateMatcher<T>());
+		}
+
+		/**
+		 * Specialization of `like` that does an std::regex match against
+		 * the given pattern (using default flags). If the match fails,
+		 * the string is printed as diagnostic.
+		 */
+		template<typename T>
+		bool like(const T& got, const std::string& pattern, const std::string& message = "") {
+			std::regex rx(pattern);
+			Predicate<T> p = [&] (const T& x) -> bool {
+				return regex_match(x, rx);
+			};
+			return like(got, p, message);
+		}
+
+		/**
+		 * Like `like` but negates the predicate.
+		 */
+		template<typename T>
+		bool unlike(const T& got, Predicate<T> p, const std::string& message = "") {
+			return isnt(got, p, message, PredicateMatcher<T>());
+		}
+
+		/**
+		 * Like `like` with a regex but negates the regex match.
+		 */
+		template<typename T>
+		bool unlike(const T& got, const std::string& pattern, const std::string& message = "") {
+			std::regex rx(pattern);
+			Predicate<T> p = [&] (const T& x) -> bool {
+				return regex_match(x, rx);
+			};
+			return unlike(got, p, message);
+		}
+
+		/**
+		 * Run the given code and succeed if no exception happens.
+		 */
+		bool lives(std::function<void(void)> f, const std::string& message = "") {
+			bool is_ok;
+			try {
+				f();
+				is_ok = pass(message);
+			}
+			catch (...) {
+				is_ok = fail(message);
+			}
+			return is_ok;
+		}
+
+		/**
+		 * Run the given code and succeed if it throws an exception of
+		 * the given type. Throwing a different exception or no exception
+		 * at all fails the test.
+		 */
+		template<typename E = std::exception>
+		bool throws(std::function<void(void)> f, const std::string& message = "") {
+			bool is_ok;
+			try {
+				f();
+				is_ok = fail(message);
+				diag("code succeeded");
+			}
+			catch (const E& e) {
+				is_ok = pass(message);
+			}
+			catch (...) {
+				is_ok = fail(message);
+				diag("different exception occurred");
+			}
+			return is_ok;
+		}
 
-			line() << "Bail out!";
-			if (!reason.empty())
-				out << " " << reason;
-			out << std::endl;
+		/**
+		 * Run the given code like `throws` but additionally check if the
+		 * exception of type E matches the predicate.
+		 */
+		template<typename E = std::exception>
+		bool throws_like(std::function<void(void)> f, Predicate<E> p, const std::string& message = "") {
+			bool is_ok;
+			try {
+				f();
+				is_ok = fail(message);
+				diag("code succeeded");
+			}
+			catch (const E& e) {
+				is_ok = like(e, p, message);
+			}
+			catch (...) {
+				is_ok = fail(message);
+				diag("different exception occurred");
+			}
+			return is_ok;
+		}
 
-			finished = true;
+		/**
+		 * Run the given code like `throws` but additionally check if the
+		 * exception of type E has a what() matching regex pattern.
+		 */
+		template<typename E = std::exception>
+		bool throws_like(std::function<void(void)> f, const std::string& pattern, const std::string& message = "") {
+			bool is_ok;
+			try {
+				f();
+				is_ok = fail(message);
+				diag("code succeeded");
+			}
+			catch (const E& e) {
+				is_ok = like(e.what(), pattern, message);
+			}
+			catch (...) {
+				is_ok = fail(message);
+				diag("different exception occurred");
+			}
+			return is_ok;
 		}
 
 		/**
-		 * Print a diagnostic message.
+		 * Check that the `q`-th quantile (between 0 and 1) of latencies
+		 * in an open-loop load report does not exceed `limit` and that
+		 * no call threw. On failure, the quantile, the offered rate and
+		 * both latency histograms are printed as diagnostics.
 		 */
-		template<typename... Ts>
-		void diag(Ts... values) {
-			print(line() << "# ", values...);
+		template<typename Rep, typename Period>
+		bool latency(const Bench::LoadReport& r, double q, std::chrono::duration<Rep, Period> limit, const std::string& message = "") {
+			using std::chrono::nanoseconds;
+			auto got = nanoseconds(r.latency.percentile(q));
+			auto max = std::chrono::duration_cast<nanoseconds>(limit);
+			bool is_ok = ok(r.calls > 0 and r.errors == 0 and got <= max, message);
+			if (!is_ok) {
+				diag("p", q * 100, " latency ", got.count() / 1e3, "us, limit ",
+				    max.count() / 1e3, "us at ", r.offered(), " calls/s offered, ",
+				    r.throughput(), " calls/s achieved");
+				diag("latency: ", r.latency);
+				diag("service: ", r.service);
+				if (r.errors > 0)
+					diag(r.errors, " of ", r.calls, " calls threw");
+			}
+			return is_ok;
 		}
 
 		/**
-		 * Check if the first argument equals the second. The meaning of
-		 * "equality" is dictated by the last argument, which defaults
-		 * to `std::equal_to`. If the test fails and the two values can
-		 * be stringified by operator<<'ing them to a stringstream, then
-		 * the differing values are printed as diagnostics.
+		 * Check that two implementations behave the same on `n` inputs
+		 * taken from `gen`, which is either a function mapping an index
+		 * to an input or a container of inputs. Both implementations are
+		 * run on parallel batches of inputs, so they must be safe to call
+		 * concurrently, and so must the Matcher, which compares their
+		 * results. Thrown exceptions must agree in type and `what()`.
+		 * Batches have 64 inputs per executor thread and `ref` is run on
+		 * all inputs of a batch before `impl`. The first divergence stops
+		 * the test: `impl` is not called on the later inputs of its batch
+		 * which are not under way yet. It is printed as diagnostics. When
+		 * all inputs agree and `verbose` holds, the speedup of `impl`
+		 * over `ref` is printed.
+		 */
+		template<typename Ref, typename Impl, typename Gen, typename Matcher = Equal>
+		bool same_behavior(Ref ref, Impl impl, Gen gen, std::size_t n, const std::string& message = "", Matcher m = Matcher()) {
+			using clock = std::chrono::steady_clock;
+			using Input = typename Feed<Gen>::Input;
+			using R1 = std::decay_t<std::invoke_result_t<Ref&,  const Input&>>;
+			using R2 = std::decay_t<std::invoke_result_t<Impl&, const Input&>>;
+			static_assert(not std::is_void_v<R1> and not std::is_void_v<R2>,
+			    "same_behavior compares return values: ref and impl must not return void");
+
+			Feed<Gen> feed(gen);
+			Executor& ex = Executor::shared();
+			std::size_t batch_size = 64 * ex.size();
+			std::vector<Input> batch;
+			clock::duration tref{0}, timpl{0};
+			std::size_t done = 0;
+			while (done < n) {
+				batch.clear();
+				while (batch.size() < batch_size and done + batch.size() < n and feed.next(batch))
+					;
+				if (batch.empty())
+					break;
+
+				std::vector<Outcome<R1>> a(batch.size());
+				std::vector<Outcome<R2>> b(batch.size());
+				/* The lowest diverging index, checked before every call */
+				std::atomic<std::size_t> first{batch.size()};
+				auto t0 = clock::now();
+				ex.parallel_for(batch.size(), [&] (std::size_t i) { a[i].capture(ref,  batch[i]); });
+				auto t1 = clock::now();
+				ex.parallel_for(batch.size(), [&] (std::size_t i) {
+					std::size_t seen = first.load();
+					if (i > seen)
+						return;
+					b[i].capture(impl, batch[i]);
+					bool same = a[i].value and b[i].value ?
+						m(*a[i].value, *b[i].value) :
+						not a[i].value and not b[i].value and a[i].exception == b[i].exception;
+					while (not same and i < seen and not first.compare_exchange_weak(seen, i))
+						;
+				});
+				auto t2 = clock::now();
+				tref  += t1 - t0;
+				timpl += t2 - t1;
+
+				if (std::size_t i = first.load(); i < batch.size()) {
+					fail(message);
+					if constexpr (Report::comments) {
+						diag("implementations diverge at input #", done + i);
+						if constexpr (Occult::Stringifiable<Input>::value)
+							diag("   Input: '" + to_string(batch[i]) + "'");
+						diag("     Ref: " + a[i].describe());
+						diag("    Impl: " + b[i].describe());
+					}
+					return false;
+				}
+				done += batch.size();
+			}
+
+			bool is_ok = pass(message);
+			if (verbose() and timpl.count() > 0) {
+				diag("speedup of impl over ref: ",
+				    std::chrono::duration<double>(tref) / std::chrono::duration<double>(timpl),
+				    "x on ", done, " inputs");
+			}
+			return is_ok;
+		}
+
+		/**
+		 * Check that `f` computes bitwise identical results no matter
+		 * how many threads it uses. `f` is called with each thread count
+		 * `runs` times. The first result is kept, of the others only a
+		 * hash. Every run but the first one perturbs the schedule of the
+		 * executors, see `Executor::perturb`. If a result differs from
+		 * the first one, the first differing byte is diagnosed. Throws
+		 * std::invalid_argument if there are no runs or thread counts.
+		 */
+		template<typename F>
+		bool deterministic(F f, unsigned int runs, const std::vector<unsigned int>& thread_counts, const std::string& message = "") {
+			if (runs == 0 or thread_counts.empty())
+				throw std::invalid_argument("deterministic needs at least one run and one thread count");
+			auto digest = [] (const auto& x) {
+				auto [p, n] = bytes_of(x);
+				return hash_bytes(p, n);
+			};
+			/* Turn the perturbation off, also if `f` throws */
+			struct Calm {
+				~Calm(void) { Executor::perturb(0); }
+			} calm;
+
+			const auto first = f(thread_counts.front());
+			const std::uint64_t expected = digest(first);
+			bool done = true;         /* The first run, see above */
+			std::uint64_t seed = 0;
+			for (unsigned int threads : thread_counts) {
+				for (unsigned int r = 1; r <= runs; ++r) {
+					if (done) {
+						done = false;
+						continue;
+					}
+					seed = mix64(seed) | 1;
+					Executor::perturb(seed);
+					auto got = f(threads);
+					Executor::perturb(0);
+					if (digest(got) == expected)
+						continue;
+
+					fail(message);
+					if constexpr (not Report::comments)
+						return false;
+					diag("run ", r, " with ", threads, " threads differs from run 1 with ",
+					    thread_counts.front(), " threads");
+					diag("schedule perturbed with seed ", seed);
+					auto [p, n] = bytes_of(first);
+					auto [q, m] = bytes_of(got);
+					std::size_t i = 0;
+					while (i < std::min(n, m) and p[i] == q[i])
+						++i;
+					if (i < std::min(n, m)) {
+						std::stringstream ss;
+						ss << "first differing byte at offset " << i << std::hex
+						   << ": expected 0x" << unsigned(p[i]) << ", got 0x" << unsigned(q[i]);
+						diag(ss.str());
+					}
+					else if (n != m) {
+						diag("results have different sizes: expected ", n, " bytes, got ", m);
+					}
+					return false;
+				}
+			}
+			return pass(message);
+		}
+
+		/**
+		 * Check that `text` contains at least one of the patterns.
+		 * The scan stops at the first hit.
+		 */
+		bool contains_any(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			bool found = false;
+			patterns.scan(text, [&] (const Patterns::Hit&) {
+				found = true;
+				return false;
+			});
+			bool is_ok = ok(found, message);
+			if (!is_ok)
+				diag("none of ", patterns.size(), " patterns found");
+			return is_ok;
+		}
+
+		/**
+		 * Check that `text` contains none of the patterns. On failure,
+		 * the hits are diagnosed with their offset, line number and
+		 * the line they occur in, up to a limit of 20.
+		 */
+		bool contains_none(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			std::vector<Patterns::Hit> hits;
+			std::size_t count = 0;
+			patterns.scan(text, [&] (const Patterns::Hit& h) {
+				if (count++ < 20)
+					hits.push_back(h);
+				return true;
+			});
+			bool is_ok = ok(count == 0, message);
+			if (!is_ok) {
+				diag_hits(text, patterns, hits);
+				if (count > hits.size())
+					diag("... and ", count - hits.size(), " more");
+			}
+			return is_ok;
+		}
+
+		/**
+		 * Check that `text` contains all of the patterns. The scan stops
+		 * when all of them were found. On failure, the missing patterns
+		 * are diagnosed.
+		 */
+		bool contains_all(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			std::vector<bool> seen(patterns.size(), false);
+			std::size_t missing = 0;
+			for (std::size_t i = 0; i < patterns.size(); ++i) {
+				if (not patterns[i].empty())
+					++missing;
+			}
+			if (missing > 0) {
+				patterns.scan(text, [&] (const Patterns::Hit& h) {
+					if (not seen[h.pattern]) {
+						seen[h.pattern] = true;
+						--missing;
+					}
+					return missing > 0;
+				});
+			}
+			/* Duplicate patterns are only ever reported under their
+			 * first index. */
+			for (std::size_t i = 0; i < patterns.size(); ++i) {
+				for (std::size_t j = 0; j < i and not seen[i]; ++j) {
+					if (patterns[j] == patterns[i] and seen[j]) {
+						seen[i] = true;
+						--missing;
+					}
+				}
+			}
+			bool is_ok = ok(missing == 0, message);
+			if (!is_ok) {
+				for (std::size_t i = 0; i < patterns.size(); ++i) {
+					if (not seen[i] and not patterns[i].empty())
+						diag("missing: '", patterns[i], "'");
+				}
+			}
+			return is_ok;
+		}
+	};
+
+	/**
+	 * The fully featured Context, which is used throughout.
+	 */
+	using Context = BasicContext<Policy::Unbuffered, Policy::Threaded, Policy::Full>;
+
+	/**
+	 * An endurance (or soak) run splits a long-running test into rolling,
+	 * time-windowed subtests of a Context. Every window is a complete
+	 * subtest which is closed and reported to the parent as soon as its
+	 * time is up, so partial results survive a crash of the process.
+	 * Each window gets diagnostics with its tallies, a latency histogram
+	 * of the operations timed through `measure` and the resource usage
+	 * of the process during the window. The state kept across windows
+	 * is constant in size, so the run can go on for days. It works on
+	 * `Context` only.
+	 */
+	class Endurance {
+		using clock = std::chrono::steady_clock;
+
+		Context& ctx;                     /**< Parent of all windows */
+		clock::duration length;           /**< Total running time    */
+		clock::duration window;           /**< Length of one window  */
+		std::string name;                 /**< Window description    */
+		clock::time_point start;          /**< Start of the run      */
+		clock::time_point window_start;   /**< Start of the window   */
+		std::unique_ptr<Context> current; /**< The open window       */
+		unsigned long windows = 0;        /**< Number of windows     */
+		Histogram latency;                /**< This window's timings */
+#ifdef TAPPP_POSIX
+		struct rusage usage{};            /**< Usage at window start */
+#endif
+
+		void open(clock::time_point now) {
+			current.reset(ctx.subtest(name + " " + std::to_string(++windows)));
+			window_start = now;
+			latency.reset();
+#ifdef TAPPP_POSIX
+			getrusage(RUSAGE_SELF, &usage);
+#endif
+		}
+
+		void close(void) {
+			Context& t = *current;
+			t.diag("tally: ", t.run, " run, ", t.good, " ok, ",
+			    t.run - t.good, " not ok, ", t.todos, " failed TODO");
+			if (latency.count() > 0)
+				t.diag("latency: ", latency);
+#ifdef TAPPP_POSIX
+			struct rusage now{};
+			getrusage(RUSAGE_SELF, &now);
+			auto seconds = [] (const struct timeval& a, const struct timeval& b) {
+				return (a.tv_sec - b.tv_sec) + (a.tv_usec - b.tv_usec) / 1e6;
+			};
+			t.diag("rusage: maxrss=", now.ru_maxrss, "kB",
+			    " utime=+", seconds(now.ru_utime, usage.ru_utime), "s",
+			    " stime=+", seconds(now.ru_stime, usage.ru_stime), "s",
+			    " minflt=+", now.ru_minflt - usage.ru_minflt,
+			    " majflt=+", now.ru_majflt - usage.ru_majflt);
+#endif
+			current->done_testing();
+			current.reset();
+		}
+
+	public:
+		/**
+		 * Prepare an endurance run of the given total `length` on `ctx`,
+		 * reported in subtests of `window` length each. The subtests are
+		 * described by `name` followed by a running number.
+		 */
+		template<typename R1, typename P1, typename R2, typename P2>
+		Endurance(Context& ctx, std::chrono::duration<R1, P1> length,
+		    std::chrono::duration<R2, P2> window, const std::string& name = "window") :
+			ctx(ctx),
+			length(std::chrono::duration_cast<clock::duration>(length)),
+			window(std::chrono::duration_cast<clock::duration>(window)),
+			name(name),
+			start(clock::now())
+		{ }
+
+		/**
+		 * Close the last window, if one is open.
+		 */
+		~Endurance(void) {
+			if (current)
+				close();
+		}
+
+		/**
+		 * Return whether the run should go on. This is meant to be the
+		 * condition of the test loop. It closes the current window if
+		 * its time is up and opens the next one. After the total time
+		 * has elapsed, the last window is closed and false returned.
+		 */
+		bool running(void) {
+			auto now = clock::now();
+			if (current && now - window_start >= window)
+				close();
+			if (now - start >= length) {
+				if (current)
+					close();
+				return false;
+			}
+			if (not current)
+				open(now);
+			return true;
+		}
+
+		/**
+		 * Return the subtest Context of the current window which is
+		 * where assertions during the run should go.
+		 */
+		Context& context(void) {
+			if (not current)
+				open(clock::now());
+			return *current;
+		}
+
+		Context* operator->(void) {
+			return &context();
+		}
+
+		/**
+		 * Record an externally measured latency in the current window.
+		 */
+		template<typename Rep, typename Period>
+		void record(std::chrono::duration<Rep, Period> d) {
+			latency.record(d);
+		}
+
+		/**
+		 * Call `f` and record its running time in the current window's
+		 * latency histogram. The result of `f` is returned.
+		 */
+		template<typename F>
+		decltype(auto) measure(F&& f) {
+			auto t0 = clock::now();
+			if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+				std::forward<F>(f)();
+				latency.record(clock::now() - t0);
+			}
+			else {
+				decltype(auto) result = std::forward<F>(f)();
+				latency.record(clock::now() - t0);
+				return result;
+			}
+		}
+	};
+
+	/**
+	 * A Suite is a registry of named top-level subtests. Unlike SUBTEST
+	 * blocks, which run in the order of the code, the subtests of a
+	 * Suite can be selected by name. This enables running the Suite in
+	 * different modes, see `main`. Subtests always get a `Context`.
+	 */
+	class Suite {
+	public:
+		/**
+		 * Resources which a subtest needs while running, or the capacity
+		 * of the machine for parallel runs. Exclusive resources are names
+		 * of things, like a port range or a directory, which only one
+		 * subtest may use at a time. The expected cost in seconds is used
+		 * to decide which subtests to run first.
+		 */
+		struct Resources {
+			unsigned int cores = 1;             /**< CPU cores           */
+			std::uint64_t memory = 0;           /**< Bytes of memory     */
+			std::vector<std::string> exclusive; /**< Exclusive resources */
+			double cost = 0;                    /**< Expected seconds    */
+		};
+
+	private:
+		struct Test {
+			std::string name;
+			std::function<void(Context&)> body;
+			std::vector<std::size_t> deps; /**< Indices of dependencies */
+			Resources needs;               /**< Resources while running */
+		};
+		std::vector<Test> tests;                  /**< Registered subtests */
+		std::vector<std::function<void(void)>> setups; /**< Fixture setup */
+		bool prepared = false;                    /**< Whether set up    */
+		Resources limits{0, 0, {}, 0};            /**< Parallel capacity */
+		std::ostream* trace_out = nullptr;        /**< Admission trace   */
+
+		/* Coverage map, see `record_coverage` and `select_affected` */
+		using Lines = std::vector<std::vector<unsigned int>>; /**< Executed lines per source */
+		std::string coverage_map;                 /**< Map to record     */
+		std::vector<std::string> sources;         /**< Instrumented sources */
+		std::vector<Lines> covers;                /**< Lines per test    */
+		std::vector<bool> unaffected;             /**< Tests not selected */
+
+		const Test* find(const std::string& name) const {
+			for (const auto& t : tests) {
+				if (t.name == name)
+					return &t;
+			}
+			return nullptr;
+		}
+
+		/**
+		 * Run a single test as a subtest of `ctx`.
+		 */
+		void run_one(Context& ctx, const Test& t) {
+			std::unique_ptr<Context> sub(ctx.subtest(t.name));
+			if (not sub->resumed())
+				execute(*sub, t);
+		}
+
+		/**
+		 * Run a test's body on its subtest `sub` and finish the subtest.
+		 * An exception escaping from the body fails the subtest.
+		 */
+		static void execute(Context& sub, const Test& t) {
+			try {
+				t.body(sub);
+			}
+			catch (const X::Required& e) {
+				sub.skip_rest("required test failed");
+			}
+			catch (const std::exception& e) {
+				sub.fail("uncaught exception");
+				sub.diag(e.what());
+			}
+			catch (...) {
+				sub.fail("uncaught exception");
+			}
+			if (not sub.finished)
+				sub.done_testing();
+		}
+
+		/**
+		 * Add the sorted `lines` to the sorted lines of `into`.
+		 */
+		static void unite(Lines& into, std::size_t k, const std::vector<unsigned int>& lines) {
+			if (into.size() <= k)
+				into.resize(k + 1);
+			std::vector<unsigned int> both;
+			std::set_union(into[k].begin(), into[k].end(), lines.begin(), lines.end(), std::back_inserter(both));
+			into[k] = std::move(both);
+		}
+
+		/**
+		 * Dump the coverage counters into the directory `dir`, reset
+		 * them and return the lines of every source in `sources` which
+		 * were executed since the last reset.
+		 */
+		Lines dump_coverage(const std::string& dir) {
+			Lines executed;
+#if defined(TAPPP_POSIX) && defined(TAPPP_COVERAGE)
+			namespace fs = std::filesystem;
+			const char* prefix = std::getenv("GCOV_PREFIX");
+			std::string saved = prefix ? prefix : "";
+			::setenv("GCOV_PREFIX", dir.c_str(), 1);
+			__gcov_dump();
+			__gcov_reset();
+			if (prefix)
+				::setenv("GCOV_PREFIX", saved.c_str(), 1);
+			else
+				::unsetenv("GCOV_PREFIX");
+
+			std::error_code ec;
+			std::vector<std::string> dumped;
+			for (fs::recursive_directory_iterator it(dir, ec), end; it != end; it.increment(ec)) {
+				if (it->path().extension() == ".gcda")
+					dumped.push_back(it->path().string());
+			}
+			for (const auto& gcda : dumped) {
+				/* The data file is below `dir` under the object's path */
+				std::string stem = gcda.substr(0, gcda.size() - 5);
+				fs::create_symlink(stem.substr(dir.size()) + ".gcno", stem + ".gcno", ec);
+				for (const auto& [source, lines] : gcov_lines(gcda)) {
+					std::size_t k = std::find(sources.begin(), sources.end(), source) - sources.begin();
+					if (k == sources.size())
+						sources.push_back(source);
+					unite(executed, k, lines);
+				}
+			}
+			fs::remove_all(dir, ec);
+#else
+			(void) dir;
+#endif
+			return executed;
+		}
+
+		/**
+		 * Write the recorded coverage map.
+		 */
+		void write_coverage(void) const {
+			std::ofstream out(coverage_map);
+			for (const auto& source : sources)
+				out << "F " << source << "\n";
+			for (std::size_t i = 0; i < tests.size() and i < covers.size(); ++i) {
+				std::ostringstream list;
+				for (std::size_t k = 0; k < covers[i].size(); ++k) {
+					const auto& lines = covers[i][k];
+					if (lines.empty())
+						continue;
+					list << (list.tellp() > 0 ? ";" : "") << k << ":";
+					for (std::size_t j = 0; j < lines.size(); ) {
+						std::size_t last = j;
+						while (last + 1 < lines.size() and lines[last + 1] == lines[last] + 1)
+							++last;
+						list << (j ? "," : "") << lines[j];
+						if (last > j)
+							list << "-" << lines[last];
+						j = last + 1;
+					}
+				}
+				if (list.tellp() > 0)
+					out << "T " << list.str() << " " << tests[i].name << "\n";
+			}
+		}
+
+		/**
+		 * Whether a dependency of the test has been run and not passed.
+		 * All dependencies must have been run.
+		 */
+		static bool blocked(const Test& t, const std::vector<int>& passed) {
+			for (auto d : t.deps) {
+				if (passed[d] == 0)
+					return true;
+			}
+			return false;
+		}
+
+	public:
+		/**
+		 * Register a subtest under the given name.
+		 */
+		Suite& add(const std::string& name, std::function<void(Context&)> body) {
+			tests.push_back({ name, std::move(body), {}, {} });
+			return *this;
+		}
+
+		/**
+		 * Register a subtest which depends on the subtests named in `deps`.
+		 * It is only run if all of them passed and skipped otherwise.
+		 * Dependencies must have been registered before, so that they
+		 * cannot form a cycle; otherwise std::invalid_argument is thrown.
+		 */
+		Suite& add(const std::string& name, const std::vector<std::string>& deps, std::function<void(Context&)> body) {
+			std::vector<std::size_t> indices;
+			for (const auto& dep : deps) {
+				auto t = find(dep);
+				if (not t)
+					throw std::invalid_argument("unknown dependency: " + dep);
+				indices.push_back(t - tests.data());
+			}
+			tests.push_back({ name, std::move(body), std::move(indices), {} });
+			return *this;
+		}
+
+		/**
+		 * Declare the resources which the named subtest needs while it
+		 * runs in `run_parallel`. Throws std::invalid_argument if there
+		 * is no such subtest.
+		 */
+		Suite& needs(const std::string& name, Resources r) {
+			for (auto& t : tests) {
+				if (t.name == name) {
+					t.needs = std::move(r);
+					return *this;
+				}
+			}
+			throw std::invalid_argument("no such subtest: " + name);
+		}
+
+		/**
+		 * Set the capacity of the machine for `run_parallel`. Zero cores
+		 * means the number of threads, zero memory means unlimited.
+		 * Exclusive resources and the cost are ignored.
+		 */
+		Suite& capacity(Resources cap) {
+			limits = std::move(cap);
+			return *this;
+		}
+
+		/**
+		 * Write a trace of the admission decisions of `run_parallel` to
+		 * `out`, or stop tracing when passed nullptr.
+		 */
+		Suite& trace(std::ostream* out) {
+			trace_out = out;
+			return *this;
+		}
+
+		/**
+		 * Register a function which prepares shared fixtures. All of them
+		 * are called once, before the first subtest is run.
+		 */
+		Suite& setup(std::function<void(void)> f) {
+			setups.push_back(std::move(f));
+			return *this;
+		}
+
+		/**
+		 * Record which lines of the instrumented source files every
+		 * subtest executes when `run` is called next and write this
+		 * coverage map to the file `map` at the end. The program has to
+		 * be built and linked with `--coverage -DTAPPP_COVERAGE` and the
+		 * compiler's `gcov` must be in the PATH; otherwise the map is
+		 * empty. The coverage counters are dumped and reset after every
+		 * subtest, so the usual coverage data of the run is lost.
+		 */
+		Suite& record_coverage(const std::string& map) {
+			coverage_map = map;
+			return *this;
+		}
+
+		/**
+		 * Select the subtests which may be affected by the `changed`
+		 * lines, according to the coverage map in the file `map`. `run`
+		 * reports the others as skipped. A change is the name of a source
+		 * file, which changes all of its lines, or a range of its lines
+		 * in the version the map was recorded from, like `foo.cpp:10-20`
+		 * or `foo.cpp:7`. A subtest is affected if it executed a changed
+		 * line, or if it is not in the map. A changed file which is not
+		 * in the map, like a build script, affects all subtests, and so
+		 * does a missing map.
 		 */
-		template<typename T, typename U, typename Matcher = std::equal_to<T>>
-		bool is(const T& got, const U& expected, const std::string& message = "", Matcher m = Matcher()) {
-			bool is_ok = ok(m(got, expected), message);
-			if (!is_ok) {
-				if constexpr (Occult::Stringifiable<T>::value) {
-					if constexpr (Occult::Stringifiable<U>::value) {
-						diag("Expected: '" + to_string(expected) + "'");
-						diag("     Got: '" + to_string(got) + "'");
+		Suite& select_affected(const std::string& map, const std::vector<std::string>& changed) {
+			unaffected.clear();
+			std::ifstream in(map);
+			if (not in)
+				return *this;
+
+			/* Line ranges as source index, first and last line */
+			using Ranges = std::vector<std::array<unsigned long, 3>>;
+			std::vector<std::string> names;
+			std::vector<std::string> known;
+			std::vector<Ranges> covered;
+			for (std::string line; std::getline(in, line); ) {
+				if (line.compare(0, 2, "F ") == 0) {
+					known.push_back(line.substr(2));
+					continue;
+				}
+				if (line.compare(0, 2, "T ") != 0)
+					continue;
+				auto space = line.find(' ', 2);
+				if (space == std::string::npos)
+					continue;
+				std::stringstream list(line.substr(2, space - 2));
+				covered.emplace_back();
+				for (std::string source; std::getline(list, source, ';'); ) {
+					auto colon = source.find(':');
+					if (colon == std::string::npos)
+						continue;
+					unsigned long k = std::stoul(source.substr(0, colon));
+					std::stringstream ranges(source.substr(colon + 1));
+					for (std::string range; std::getline(ranges, range, ','); ) {
+						auto dash = range.find('-');
+						unsigned long first = std::stoul(range.substr(0, dash));
+						unsigned long last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+						covered.back().push_back({ k, first, last });
 					}
-					else {
-						diag("Got: '" + to_string(got) + "'");
+				}
+				names.push_back(line.substr(space + 1));
+			}
+
+			Ranges hit;
+			for (const auto& change : changed) {
+				std::string file = change;
+				unsigned long first = 0, last = std::numeric_limits<unsigned long>::max();
+				auto colon = change.rfind(':');
+				if (colon != std::string::npos and colon + 1 < change.size() and
+				    change.find_first_not_of("0123456789-", colon + 1) == std::string::npos and
+				    change[colon + 1] != '-') {
+					file = change.substr(0, colon);
+					auto dash = change.find('-', colon);
+					first = std::stoul(change.substr(colon + 1));
+					last = dash == std::string::npos ? first : std::stoul(change.substr(dash + 1));
+				}
+				bool matched = false;
+				for (std::size_t k = 0; k < known.size(); ++k) {
+					if (same_file(known[k], file)) {
+						hit.push_back({ k, first, last });
+						matched = true;
 					}
 				}
+				if (not matched)
+					return *this;
 			}
-			return is_ok;
+
+			unaffected.assign(tests.size(), false);
+			for (std::size_t i = 0; i < tests.size(); ++i) {
+				auto it = std::find(names.begin(), names.end(), tests[i].name);
+				if (it == names.end())
+					continue;
+				const auto& rs = covered[it - names.begin()];
+				unaffected[i] = std::none_of(rs.begin(), rs.end(), [&] (const auto& r) {
+					return std::any_of(hit.begin(), hit.end(), [&] (const auto& h) {
+						return h[0] == r[0] and h[1] <= r[2] and r[1] <= h[2];
+					});
+				});
+			}
+			return *this;
 		}
 
 		/**
-		 * Like `is` but negates the comparison.
+		 * Call the setup functions unless that happened already.
 		 */
-		template<typename T, typename U, typename Matcher = std::equal_to<T>>
-		bool isnt(const T& got, const U& unexpected, const std::string& message = "", Matcher m = Matcher()) {
-			bool is_ok = nok(m(got, unexpected), message);
-			if (!is_ok) {
-				if constexpr (Occult::Stringifiable<T>::value)
-					diag("Got: '" + to_string(got) + "'");
-			}
-			return is_ok;
+		void prepare(void) {
+			if (prepared)
+				return;
+			for (auto& f : setups)
+				f();
+			prepared = true;
 		}
 
 		/**
-		 * Test the value against a predicate. Uses `is` internally, so on
-		 * failure a best effort is made to print the unexpected value.
+		 * Names of all registered subtests in order.
 		 */
-		template<typename T>
-		bool like(const T& got, Predicate<T> p, const std::string& message = "") {
-			return is(got, p, message, PredicateMatcher<T>());
+		std::vector<std::string> names(void) const {
+			std::vector<std::string> ret;
+			for (const auto& t : tests)
+				ret.push_back(t.name);
+			return ret;
 		}
 
 		/**
-		 * Specialization of `like` that does an std::regex match against
-		 * the given pattern (using default flags). If the match fails,
-		 * the string is printed as diagnostic.
+		 * Run the named subtests on `ctx` in the given order, or all of
+		 * them in order of registration if `which` is empty. An unknown
+		 * name fails a test. Every subtest runs at most once, and the
+		 * dependencies of a selected subtest run before it even if they
+		 * are not selected. Subtests which are not selected by
+		 * `select_affected` are skipped and count as passed.
 		 */
-		template<typename T>
-		bool like(const T& got, const std::string& pattern, const std::string& message = "") {
-			std::regex rx(pattern);
-			Predicate<T> p = [&] (const T& x) -> bool {
-				return regex_match(x, rx);
+		void run(Context& ctx, const std::vector<std::string>& which = {}) {
+			bool recording = not coverage_map.empty();
+			std::string dumps = coverage_map + ".d";
+			Lines fixtures;
+			if (recording) {
+				dump_coverage(dumps);
+				prepare();
+				fixtures = dump_coverage(dumps);
+				covers.assign(tests.size(), {});
+			}
+			prepare();
+
+			/* -1 means not run, otherwise whether the test passed */
+			std::vector<int> passed(tests.size(), -1);
+			std::function<void(const Test&)> run_tracked = [&] (const Test& t) {
+				std::size_t i = &t - tests.data();
+				if (passed[i] >= 0)
+					return;
+				/* Pull in dependencies which were not selected */
+				for (auto d : t.deps) {
+					if (passed[d] < 0)
+						run_tracked(tests[d]);
+				}
+				if (blocked(t, passed)) {
+					std::unique_ptr<Context> sub(ctx.subtest(t.name));
+					if (not sub->resumed())
+						sub->plan(SKIP_ALL, "dependency failed");
+					passed[i] = 0;
+					return;
+				}
+				if (i < unaffected.size() and unaffected[i]) {
+					ctx.pass(t.name + " # SKIP unaffected");
+					passed[i] = 1;
+					return;
+				}
+				std::unique_ptr<Context> sub(ctx.subtest(t.name));
+				if (not sub->resumed())
+					execute(*sub, t);
+				passed[i] = sub->summary();
+				if (recording) {
+					/* Fixtures are part of every subtest */
+					covers[i] = dump_coverage(dumps);
+					for (std::size_t k = 0; k < fixtures.size(); ++k)
+						unite(covers[i], k, fixtures[k]);
+				}
 			};
-			return like(got, p, message);
+
+			if (which.empty()) {
+				for (const auto& t : tests)
+					run_tracked(t);
+			}
+			else {
+				for (const auto& name : which) {
+					if (auto t = find(name))
+						run_tracked(*t);
+					else
+						ctx.fail("no such subtest: " + name);
+				}
+			}
+			if (recording)
+				write_coverage();
 		}
 
 		/**
-		 * Like `like` but negates the predicate.
+		 * Run all subtests as tasks on the shared Executor, or on an
+		 * executor of their own if `threads` is larger. A subtest becomes
+		 * ready as soon as all of its dependencies passed, and subtests
+		 * whose dependencies failed are skipped. Ready subtests are
+		 * admitted when their resource needs fit into the free capacity,
+		 * preferring those with the longest chain of expected work ahead
+		 * of them, which keeps the total running time short. A subtest
+		 * needing more than the whole capacity is admitted alone.
+		 *
+		 * Every subtest runs on a thread subtest of `ctx`, which are
+		 * merged as soon as all subtests registered before them are done,
+		 * so the output is in order of registration. At most `threads`
+		 * subtests run at once. That defaults to the cores capacity,
+		 * which defaults to the size of the shared executor.
 		 */
-		template<typename T>
-		bool unlike(const T& got, Predicate<T> p, const std::string& message = "") {
-			return isnt(got, p, message, PredicateMatcher<T>());
+		void run_parallel(Context& ctx, unsigned int threads = 0) {
+			using clock = std::chrono::steady_clock;
+			prepare();
+			ctx.merge();
+
+			std::size_t n = tests.size();
+			std::vector<Context*> subs;
+			for (const auto& t : tests)
+				subs.push_back(ctx.thread_subtest(t.name));
+
+			Resources cap = limits;
+			if (cap.cores == 0)
+				cap.cores = threads ? threads : Executor::shared().size();
+			if (threads == 0)
+				threads = cap.cores;
+
+			/* Priority: expected cost of the longest dependency chain
+			 * starting at a subtest. Dependents are registered later. */
+			std::vector<std::vector<std::size_t>> dependents(n);
+			for (std::size_t i = 0; i < n; ++i) {
+				for (auto d : tests[i].deps)
+					dependents[d].push_back(i);
+			}
+			std::vector<double> priority(n);
+			for (std::size_t i = n; i-- > 0; ) {
+				double longest = 0;
+				for (auto d : dependents[i])
+					longest = std::max(longest, priority[d]);
+				priority[i] = (tests[i].needs.cost > 0 ? tests[i].needs.cost : 1) + longest;
+			}
+
+			std::mutex mtx;
+			std::vector<int> passed(n, -1);
+			std::vector<std::size_t> waiting(n);
+			std::vector<std::size_t> ready; /**< Sorted by priority */
+			std::vector<bool> deferred(n, false);
+			std::vector<std::string> in_use;
+			unsigned int cores = 0;
+			std::uint64_t memory = 0;
+			std::size_t running = 0;
+			auto start = clock::now();
+
+			auto log = [&] (const std::string& what, std::size_t i) {
+				if (not trace_out)
+					return;
+				const Resources& r = tests[i].needs;
+				*trace_out << std::fixed << std::setprecision(3)
+				    << std::chrono::duration<double>(clock::now() - start).count()
+				    << "s " << what << " '" << tests[i].name << "' (cores "
+				    << r.cores << ", " << cores << "/" << cap.cores << " used";
+				if (r.memory or cap.memory)
+					*trace_out << "; memory " << r.memory << ", " << memory << "/" << cap.memory << " used";
+				for (const auto& e : r.exclusive)
+					*trace_out << "; exclusive " << e;
+				*trace_out << ")" << std::endl;
+			};
+			auto make_ready = [&] (std::size_t i) {
+				auto pos = std::find_if(ready.begin(), ready.end(),
+				    [&] (std::size_t j) { return priority[j] < priority[i]; });
+				ready.insert(pos, i);
+			};
+			auto fits = [&] (std::size_t i) {
+				if (blocked(tests[i], passed) or running == 0)
+					return true;
+				const Resources& r = tests[i].needs;
+				if (cores + r.cores > cap.cores)
+					return false;
+				if (cap.memory and memory + r.memory > cap.memory)
+					return false;
+				for (const auto& e : r.exclusive) {
+					if (std::find(in_use.begin(), in_use.end(), e) != in_use.end())
+						return false;
+				}
+				return true;
+			};
+			/* Find the first ready subtest which fits, or n. */
+			auto choose = [&] {
+				for (auto it = ready.begin(); it != ready.end(); ++it) {
+					std::size_t i = *it;
+					if (fits(i)) {
+						ready.erase(it);
+						return i;
+					}
+					if (not deferred[i]) {
+						deferred[i] = true;
+						log("defer", i);
+					}
+				}
+				return n;
+			};
+
+			for (std::size_t i = 0; i < n; ++i) {
+				waiting[i] = tests[i].deps.size();
+				if (waiting[i] == 0)
+					make_ready(i);
+			}
+
+			std::unique_ptr<Executor> own;
+			Executor* ex = &Executor::shared();
+			if (threads > ex->size())
+				ex = (own = std::make_unique<Executor>(threads)).get();
+			Executor::Group group(*ex);
+
+			/* Merge the finished prefix. Ranges are claimed under the lock
+			 * and each contains only finished subtests, so they may be
+			 * merged in any order. */
+			std::mutex merge_mtx;
+			std::size_t merged = 0;
+			auto claim = [&] {
+				std::size_t k = merged;
+				while (k < n and passed[k] >= 0)
+					++k;
+				std::swap(k, merged);
+				return merged - k;
+			};
+			auto flush = [&] (std::size_t count) {
+				if (count == 0)
+					return;
+				std::lock_guard<std::mutex> lock(merge_mtx);
+				ctx.merge(count);
+			};
+
+			/* Start ready subtests which fit while fewer than `threads`
+			 * are running. Called with the lock held. Every subtest is
+			 * a task which, when it is done, dispatches its successors. */
+			std::function<void(void)> dispatch = [&] {
+				for (std::size_t i; running < threads and (i = choose()) < n; ) {
+					bool skip = blocked(tests[i], passed);
+					const Resources& r = tests[i].needs;
+					if (not skip) {
+						cores += r.cores;
+						memory += r.memory;
+						in_use.insert(in_use.end(), r.exclusive.begin(), r.exclusive.end());
+						log("admit", i);
+					}
+					++running;
+					group.run([&, i, skip] {
+						Context& sub = *subs[i];
+						if (sub.resumed()) {
+							/* Replayed from the journal */
+						}
+						else if (skip) {
+							sub.plan(SKIP_ALL, "dependency failed");
+						}
+						else {
+							execute(sub, tests[i]);
+						}
+						/* A skipped subtest is not ok, also when replayed */
+						bool is_ok = not skip and sub.summary();
+
+						std::size_t count;
+						{
+							std::lock_guard<std::mutex> lock(mtx);
+							const Resources& r = tests[i].needs;
+							if (not skip) {
+								cores -= r.cores;
+								memory -= r.memory;
+								for (const auto& e : r.exclusive)
+									in_use.erase(std::find(in_use.begin(), in_use.end(), e));
+								log("finish", i);
+							}
+							--running;
+							passed[i] = is_ok;
+							for (auto d : dependents[i]) {
+								if (--waiting[d] == 0)
+									make_ready(d);
+							}
+							dispatch();
+							count = claim();
+						}
+						flush(count);
+					});
+				}
+			};
+
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				dispatch();
+			}
+			group.wait();
 		}
 
+#ifdef TAPPP_POSIX
 		/**
-		 * Like `like` with a regex but negates the regex match.
+		 * Server mode: set up the fixtures once and then accept requests
+		 * on a Unix domain socket at `path`. Each request is served by
+		 * a forked child process, which shares the fixtures with the
+		 * server copy-on-write, runs the requested subtests on a fresh
+		 * top-level Context and streams the TAP back. A request consists
+		 * of lines: the first is a command, `run`, `list` or `quit`, the
+		 * others are subtest names for `run`. The server returns when it
+		 * receives `quit`.
 		 */
-		template<typename T>
-		bool unlike(const T& got, const std::string& pattern, const std::string& message = "") {
-			std::regex rx(pattern);
-			Predicate<T> p = [&] (const T& x) -> bool {
-				return regex_match(x, rx);
-			};
-			return unlike(got, p, message);
+		void serve(const std::string& path) {
+			prepare();
+
+			int srv = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (srv < 0)
+				throw std::system_error(errno, std::generic_category(), "socket");
+			struct sockaddr_un addr{};
+			addr.sun_family = AF_UNIX;
+			std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+			::unlink(path.c_str());
+			if (::bind(srv, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 or ::listen(srv, 16) < 0) {
+				int err = errno;
+				::close(srv);
+				throw std::system_error(err, std::generic_category(), path);
+			}
+
+			/* Let the kernel reap the children */
+			auto reaper = ::signal(SIGCHLD, SIG_IGN);
+			for (;;) {
+				int conn = ::accept(srv, nullptr, nullptr);
+				if (conn < 0) {
+					if (errno == EINTR)
+						continue;
+					break;
+				}
+
+				std::stringstream request(slurp(conn));
+				std::string command;
+				std::getline(request, command);
+				std::vector<std::string> which;
+				for (std::string name; std::getline(request, name); )
+					which.push_back(name);
+
+				if (command == "quit") {
+					::close(conn);
+					break;
+				}
+				if (command == "list") {
+					FdBuf buf(conn);
+					std::ostream out(&buf);
+					for (const auto& t : tests)
+						out << t.name << "\n";
+				}
+				else if (command == "run") {
+					pid_t pid = ::fork();
+					if (pid == 0) {
+						::close(srv);
+						{
+							FdBuf buf(conn);
+							std::ostream out(&buf);
+							Context ctx(out);
+							run(ctx, which);
+						}
+						::_exit(0);
+					}
+					if (pid < 0) {
+						FdBuf buf(conn);
+						std::ostream(&buf) << "Bail out! fork: " << std::strerror(errno) << "\n";
+					}
+				}
+				::close(conn);
+			}
+			::signal(SIGCHLD, reaper);
+			::close(srv);
+			::unlink(path.c_str());
 		}
 
 		/**
-		 * Run the given code and succeed if no exception happens.
+		 * Running check of a TAP document which arrives in pieces: it
+		 * succeeds if it has a plan which matches the number of top-level
+		 * test points, none of which failed outside of a TODO, and it
+		 * does not bail out.
 		 */
-		bool lives(std::function<void(void)> f, const std::string& message = "") {
-			bool is_ok;
-			try {
-				f();
-				is_ok = pass(message);
+		class Verdict {
+			long planned = -1, count = 0;
+			bool good = true;
+			std::string partial;   /**< Incomplete last line */
+
+			void line(const std::string& l) {
+				if (l.rfind("Bail out!", 0) == 0)
+					good = false;
+				else if (l.rfind("1..", 0) == 0)
+					planned = std::strtol(l.c_str() + 3, nullptr, 10);
+				else if (l.rfind("ok", 0) == 0)
+					++count;
+				else if (l.rfind("not ok", 0) == 0) {
+					++count;
+					if (l.find("# TODO") == std::string::npos)
+						good = false;
+				}
 			}
-			catch (...) {
-				is_ok = fail(message);
+
+		public:
+			/**
+			 * Check the next `n` bytes of the document.
+			 */
+			void feed(const char* data, std::size_t n) {
+				partial.append(data, n);
+				std::size_t start = 0;
+				for (std::size_t nl; (nl = partial.find('\n', start)) != std::string::npos; start = nl + 1)
+					line(partial.substr(start, nl - start));
+				partial.erase(0, start);
 			}
-			return is_ok;
-		}
+
+			/**
+			 * Whether the document fed so far succeeds.
+			 */
+			bool succeeded(void) {
+				if (not partial.empty()) {
+					line(partial);
+					partial.clear();
+				}
+				return good and planned == count;
+			}
+		};
 
 		/**
-		 * Run the given code and succeed if it throws an exception of
-		 * the given type. Throwing a different exception or no exception
-		 * at all fails the test.
+		 * Client for the server mode: send a command and subtest names
+		 * to the server at `path` and copy its response to `out` as it
+		 * arrives, flushing after every piece. If `verdict` is given, the
+		 * response is also fed to it. The connection is retried for a
+		 * second, giving the server time to start. Returns false if the
+		 * server cannot be reached. If the fork for a `run` fails, the
+		 * server replies with a `Bail out!`.
 		 */
-		template<typename E = std::exception>
-		bool throws(std::function<void(void)> f, const std::string& message = "") {
-			bool is_ok;
-			try {
-				f();
-				is_ok = fail(message);
-				diag("code succeeded");
+		static bool request(const std::string& path, const std::string& command,
+		    const std::vector<std::string>& which, std::ostream& out, Verdict* verdict = nullptr) {
+			struct sockaddr_un addr{};
+			addr.sun_family = AF_UNIX;
+			std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+			int conn = -1;
+			for (int tries = 0; tries < 100; ++tries) {
+				conn = ::socket(AF_UNIX, SOCK_STREAM, 0);
+				if (conn < 0)
+					return false;
+				if (::connect(conn, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)
+					break;
+				::close(conn);
+				conn = -1;
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
 			}
-			catch (const E& e) {
-				is_ok = pass(message);
+			if (conn < 0)
+				return false;
+
+			std::string req = command + "\n";
+			for (const auto& name : which)
+				req += name + "\n";
+			{
+				FdBuf buf(conn);
+				std::ostream(&buf) << req;
 			}
-			catch (...) {
-				is_ok = fail(message);
-				diag("different exception occurred");
+			::shutdown(conn, SHUT_WR);
+			char buf[4096];
+			for (;;) {
+				ssize_t n = ::read(conn, buf, sizeof(buf));
+				if (n < 0 and errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				out.write(buf, n).flush();
+				if (verdict)
+					verdict->feed(buf, n);
 			}
-			return is_ok;
+			::close(conn);
+			return true;
 		}
 
 		/**
-		 * Run the given code like `throws` but additionally check if the
-		 * exception of type E matches the predicate.
+		 * Whether the TAP document `tap`, as returned by the server for
+		 * a `run`, reports success, see `Verdict`.
 		 */
-		template<typename E = std::exception>
-		bool throws_like(std::function<void(void)> f, Predicate<E> p, const std::string& message = "") {
-			bool is_ok;
-			try {
-				f();
-				is_ok = fail(message);
-				diag("code succeeded");
+		static bool succeeded(const std::string& tap) {
+			Verdict verdict;
+			verdict.feed(tap.data(), tap.size());
+			return verdict.succeeded();
+		}
+
+		/**
+		 * Distribute all subtests over `workers` forked worker processes,
+		 * which share the fixtures with this process copy-on-write. The
+		 * coordinator hands out one subtest at a time to whichever worker
+		 * is idle, over a Unix socket pair, so that long and short
+		 * subtests balance out. Each worker runs its subtest on a thread
+		 * subtest of its copy of `ctx` and sends the buffered TAP back.
+		 * The results are reported on `ctx` in order of registration.
+		 *
+		 * Dependencies are honored like in `run_parallel`. If a worker
+		 * dies while running a subtest, it is replaced and the subtest is
+		 * retried once on another worker; if that one dies too, the
+		 * subtest fails. The number of workers defaults to one per CPU.
+		 */
+		void distribute(Context& ctx, unsigned int workers = 0) {
+			prepare();
+			ctx.merge();
+			if (workers == 0)
+				workers = jobs();
+
+			std::size_t n = tests.size();
+			const std::size_t idle = n;
+			struct Worker {
+				pid_t pid = -1;
+				int fd = -1;
+				std::size_t task;
+				std::string inbox;
+			};
+			std::vector<Worker> pool(workers);
+
+			/* Worker side: run the subtest whose index is sent and reply
+			 * with "<summary> <length>\n" followed by its TAP. */
+			auto work = [&] (int fd) {
+				FdBuf buf(fd);
+				std::ostream reply(&buf);
+				std::string line;
+				for (char c; ; ) {
+					ssize_t r = ::read(fd, &c, 1);
+					if (r < 0 and errno == EINTR)
+						continue;
+					if (r <= 0)
+						break;
+					if (c != '\n') {
+						line += c;
+						continue;
+					}
+					const Test& t = tests[std::stoul(line)];
+					line.clear();
+					Context* sub = ctx.thread_subtest(t.name);
+					execute(*sub, t);
+					auto& d = ctx.detached.back();
+					std::string text = d.buffer->str();
+					if (d.diag_buffer)
+						*ctx.diag_out << d.diag_buffer->str() << std::flush;
+					reply << sub->summary() << " " << text.size() << "\n" << text << std::flush;
+					ctx.detached.clear();
+				}
+			};
+			auto spawn = [&] (Worker& w) {
+				int sv[2];
+				if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+					throw std::system_error(errno, std::generic_category(), "socketpair");
+				std::cout << std::flush;
+				w.pid = ::fork();
+				if (w.pid < 0) {
+					int err = errno;
+					::close(sv[0]);
+					::close(sv[1]);
+					throw std::system_error(err, std::generic_category(), "fork");
+				}
+				if (w.pid == 0) {
+					::close(sv[0]);
+					/* Only the coordinator keeps the journal */
+					if (ctx.journal_fd >= 0)
+						::close(ctx.journal_fd);
+					ctx.journal_fd = -1;
+					ctx.replay.clear();
+					for (const auto& other : pool) {
+						if (other.fd >= 0)
+							::close(other.fd);
+					}
+					work(sv[1]);
+					::_exit(0);
+				}
+				::close(sv[1]);
+				w.fd = sv[0];
+				w.task = idle;
+				w.inbox.clear();
+			};
+			for (auto& w : pool)
+				spawn(w);
+
+			/* Results in TAP of finished subtests, -1 means not done */
+			std::vector<int> passed(n, -1);
+			std::vector<std::string> output(n);
+			std::vector<bool> skipped(n, false);
+			std::vector<unsigned int> crashes(n, 0);
+			std::vector<std::size_t> waiting(n);
+			std::vector<std::vector<std::size_t>> dependents(n);
+			std::deque<std::size_t> ready;
+			for (std::size_t i = 0; i < n; ++i) {
+				waiting[i] = tests[i].deps.size();
+				for (auto d : tests[i].deps)
+					dependents[d].push_back(i);
+				if (waiting[i] == 0)
+					ready.push_back(i);
 			}
-			catch (const E& e) {
-				is_ok = like(e, p, message);
+
+			/* Render the TAP of a subtest which no worker ran */
+			auto stand_in = [&] (std::size_t i, const std::function<void(Context&)>& f) {
+				std::ostringstream text;
+				Context sub(text);
+				sub.depth = ctx.depth + 1;
+				f(sub);
+				if (not sub.finished)
+					sub.done_testing();
+				output[i] = text.str();
+				return sub.summary();
+			};
+			auto complete = [&] (std::size_t i, bool is_ok) {
+				passed[i] = is_ok;
+				for (auto d : dependents[i]) {
+					if (--waiting[d] == 0)
+						ready.push_back(d);
+				}
+			};
+
+			std::size_t merged = 0, done = 0;
+			while (merged < n) {
+				/* Skip blocked subtests and hand out the others */
+				for (auto& w : pool) {
+					while (w.task == idle and not ready.empty()) {
+						std::size_t i = ready.front();
+						ready.pop_front();
+						if (blocked(tests[i], passed)) {
+							stand_in(i, [] (Context& sub) { sub.plan(SKIP_ALL, "dependency failed"); });
+							skipped[i] = true;
+							complete(i, false);
+							++done;
+							continue;
+						}
+						std::string msg = std::to_string(i) + "\n";
+						::send(w.fd, msg.data(), msg.size(), MSG_NOSIGNAL);
+						w.task = i;
+					}
+				}
+
+				/* Emit the finished prefix in order */
+				for (; merged < n and passed[merged] >= 0; ++merged) {
+					ctx.out << output[merged] << std::flush;
+					if (skipped[merged])
+						ctx.pass(tests[merged].name + " # SKIP dependency failed");
+					else
+						ctx.ok(passed[merged], tests[merged].name);
+					output[merged].clear();
+				}
+				if (done == n)
+					continue;
+
+				std::vector<struct pollfd> fds;
+				for (const auto& w : pool)
+					fds.push_back({ w.fd, POLLIN, 0 });
+				if (::poll(fds.data(), fds.size(), -1) < 0) {
+					if (errno == EINTR)
+						continue;
+					throw std::system_error(errno, std::generic_category(), "poll");
+				}
+
+				for (std::size_t k = 0; k < pool.size(); ++k) {
+					if (fds[k].revents == 0)
+						continue;
+					Worker& w = pool[k];
+					char buf[4096];
+					ssize_t r = ::read(w.fd, buf, sizeof(buf));
+					if (r < 0 and errno == EINTR)
+						continue;
+					if (r > 0) {
+						w.inbox.append(buf, r);
+						auto eol = w.inbox.find('\n');
+						if (eol == std::string::npos)
+							continue;
+						std::istringstream header(w.inbox.substr(0, eol));
+						int is_ok = 0;
+						std::size_t length = 0;
+						header >> is_ok >> length;
+						if (w.inbox.size() < eol + 1 + length)
+							continue;
+						std::size_t i = w.task;
+						output[i] = w.inbox.substr(eol + 1, length);
+						if (crashes[i] > 0) {
+							output[i].insert(0, std::string(4 * (ctx.depth + 1), ' ') +
+							    "# retried after worker crash\n");
+						}
+						w.inbox.erase(0, eol + 1 + length);
+						w.task = idle;
+						complete(i, is_ok);
+						++done;
+						continue;
+					}
+
+					/* The worker died: replace it and retry its subtest */
+					int status = 0;
+					::close(w.fd);
+					w.fd = -1;
+					::waitpid(w.pid, &status, 0);
+					std::size_t i = w.task;
+					spawn(w);
+					if (i == idle)
+						continue;
+					if (++crashes[i] < 2) {
+						ready.push_front(i);
+						continue;
+					}
+					std::string why = WIFSIGNALED(status) ?
+						"killed by signal " + std::to_string(WTERMSIG(status)) :
+						"exit status " + std::to_string(WEXITSTATUS(status));
+					complete(i, stand_in(i, [&] (Context& sub) {
+						sub.fail("worker process crashed");
+						sub.diag("worker crashed twice, last ", why);
+					}));
+					++done;
+				}
 			}
-			catch (...) {
-				is_ok = fail(message);
-				diag("different exception occurred");
+
+			for (auto& w : pool) {
+				::close(w.fd);
+				::waitpid(w.pid, nullptr, 0);
 			}
-			return is_ok;
 		}
+#endif
 
 		/**
-		 * Run the given code like `throws` but additionally check if the
-		 * exception of type E has a what() matching regex pattern.
+		 * Run the Suite according to command-line arguments, which are
+		 * meant to be passed on from the test program's `main`:
+		 *
+		 *   (none)              run all subtests on `ctx`
+		 *   NAME...             run the named subtests on `ctx`
+		 *   --list              print the subtest names
+		 *   --serve PATH        server mode on the socket PATH
+		 *   --client PATH NAME...  run subtests on the server at PATH
+		 *   --quit PATH         stop the server at PATH
+		 *   --workers N         distribute all subtests over N processes
+		 *   --record-coverage MAP  run all subtests, recording a coverage map
+		 *   --affected MAP FILE...  run the subtests affected by changed FILEs,
+		 *                           each optionally followed by :FIRST-LAST
+		 *
+		 * In the server modes, `ctx` prints no TAP of its own: `--serve`
+		 * and `--quit` skip it and `--client` relays the server's document
+		 * instead, as it arrives.
+		 * The return value is meant to be the exit code of the program;
+		 * for `--client` it reflects the relayed results.
 		 */
-		template<typename E = std::exception>
-		bool throws_like(std::function<void(void)> f, const std::string& pattern, const std::string& message = "") {
-			bool is_ok;
-			try {
-				f();
-				is_ok = fail(message);
-				diag("code succeeded");
+		int main(Context& ctx, int argc, char* argv[]) {
+			std::vector<std::string> args(argv + 1, argv + argc);
+			if (not args.empty() and args[0] == "--list") {
+				ctx.plan(SKIP_ALL, "listing subtests");
+				for (const auto& t : tests)
+					std::cout << "# " << t.name << std::endl;
+				return EXIT_SUCCESS;
 			}
-			catch (const E& e) {
-				is_ok = like(e.what(), pattern, message);
+#ifdef TAPPP_POSIX
+			if (not args.empty() and (args[0] == "--serve" or args[0] == "--client" or args[0] == "--quit")) {
+				if (args.size() < 2) {
+					ctx.BAIL("usage: " + args[0] + " PATH");
+					return EXIT_FAILURE;
+				}
+				if (args[0] == "--serve") {
+					ctx.plan(SKIP_ALL, "server mode");
+					serve(args[1]);
+					return EXIT_SUCCESS;
+				}
+				std::vector<std::string> which(args.begin() + 2, args.end());
+				if (args[0] == "--quit") {
+					std::ostringstream none;
+					if (not request(args[1], "quit", which, none)) {
+						ctx.BAIL("cannot reach server at " + args[1]);
+						return EXIT_FAILURE;
+					}
+					ctx.plan(SKIP_ALL, "server stopped");
+					return EXIT_SUCCESS;
+				}
+				/* The server's TAP is the whole document: print no plan of our own */
+				ctx.finished = true;
+				Verdict verdict;
+				if (not request(args[1], "run", which, ctx.out, &verdict)) {
+					ctx.out << "Bail out! cannot reach server at " << args[1] << std::endl;
+					return EXIT_FAILURE;
+				}
+				return verdict.succeeded() ? EXIT_SUCCESS : EXIT_FAILURE;
 			}
-			catch (...) {
-				is_ok = fail(message);
-				diag("different exception occurred");
+			if (args.size() == 2 and args[0] == "--workers") {
+				distribute(ctx, std::stoul(args[1]));
+				return EXIT_SUCCESS;
 			}
-			return is_ok;
+#endif
+			if (args.size() == 2 and args[0] == "--record-coverage") {
+				record_coverage(args[1]);
+				args.clear();
+			}
+			else if (args.size() >= 2 and args[0] == "--affected") {
+				select_affected(args[1], std::vector<std::string>(args.begin() + 2, args.end()));
+				args.clear();
+			}
+			run(ctx, args);
+			return EXIT_SUCCESS;
 		}
 	};
 
@@ -572,11 +4983,42 @@ namespace TAP {
 	 * TAPP object.
 	 */
 	namespace {
-		auto TAPP = std::make_shared<Context>();
+		auto TAPP = [] {
+			auto ctx = std::make_shared<Context>();
+			if (const char* sink = std::getenv("TAPPP_DIAG"); sink and std::string(sink) == "stderr")
+				ctx->diagnostics(&std::cerr);
+			if (const char* secs = std::getenv("TAPPP_HEARTBEAT")) {
+				const char* status = std::getenv("TAPPP_STATUS");
+				ctx->heartbeat(std::chrono::milliseconds(static_cast<long>(1000 * std::strtod(secs, nullptr))),
+				    status ? status : "");
+			}
+#ifdef TAPPP_POSIX
+			if (const char* n = std::getenv("TAPPP_SLOWEST"))
+				ctx->slowest(std::strtoul(n, nullptr, 10));
+			if (const char* path = std::getenv("TAPPP_JOURNAL")) {
+				const char* resume = std::getenv("TAPPP_RESUME");
+				ctx->journal(path, resume and *resume and std::string(resume) != "0");
+			}
+#endif
+			return ctx;
+		}();
 
 		void plan(unsigned int tests) { TAPP->plan(tests);      }
 		bool summary(void)            { return TAPP->summary(); }
 		void done_testing(void)       { TAPP->done_testing();   }
+		Context::Stats stats(void)    { return TAPP->stats();   }
+		Tier tier(void)               { return Context::tier(); }
+
+		template<typename T, typename F>
+		const T& fixture(const std::string& name, F factory) { return TAPP->fixture<T>(name, std::move(factory)); }
+
+		template<typename T, typename F>
+		const T& fixture(F factory) { return TAPP->fixture<T>(std::move(factory)); }
+		bool within_tier(Tier cost, unsigned int how_many = 1) { return TAPP->within_tier(cost, how_many); }
+		Context::Sample sampled(double rate, std::uint64_t seed = 0) { return TAPP->sampled(rate, seed); }
+		void heartbeat(std::chrono::milliseconds period, const std::string& status = "") {
+			TAPP->heartbeat(period, status);
+		}
 		void plan(const skip_all& skip [[maybe_unused]], const std::string& reason = "") {
 			return TAPP->plan(skip, reason);
 		}
@@ -585,9 +5027,12 @@ namespace TAP {
 			/**
 			 * RAII object that represents an active subtest. When it is
 			 * destroyed, it reinstates the subtest's parent as the TAPP.
+			 * A block which is left by an exception, such as the one of
+			 * a failed `require`, skips the rest of the subtest's plan.
 			 */
 			struct Guard {
 				std::shared_ptr<Context> top;
+				int unwinding = std::uncaught_exceptions();
 
 				Guard(Context* sub) {
 					top = TAPP;
@@ -595,8 +5040,18 @@ namespace TAP {
 				}
 
 				~Guard(void) {
+					if (std::uncaught_exceptions() > unwinding and not TAPP->resumed())
+						TAPP->skip_rest("subtest block abandoned");
 					TAPP = top;
 				}
+
+				/**
+				 * Whether the subtest's block should be run, which is
+				 * not the case when it was resumed from a journal.
+				 */
+				explicit operator bool(void) const {
+					return not TAPP->resumed();
+				}
 			};
 		}
 
@@ -609,35 +5064,114 @@ namespace TAP {
 		}
 
 		/**
-		 * Syntactic sugar macro for a "SUBTEST" block.
+		 * Functional variant of the SUBTEST block: install the subtest
+		 * as TAPP while `f` runs. Only this variant stops the subtest
+		 * at a failed `require`.
+		 */
+		bool subtest(const std::string& message, std::function<void(void)> f) {
+			auto top = TAPP;
+			return top->subtest(message, [&] (Context& sub) {
+				/* Share ownership with the parent: the subtest itself
+				 * is owned by the Context method. */
+				TAPP = std::shared_ptr<Context>(top, &sub);
+				try {
+					f();
+				}
+				catch (...) {
+					TAPP = top;
+					throw;
+				}
+				TAPP = top;
+			});
+		}
+
+		bool subtest(unsigned int tests, const std::string& message, std::function<void(void)> f) {
+			auto top = TAPP;
+			return top->subtest(tests, message, [&] (Context& sub) {
+				TAPP = std::shared_ptr<Context>(top, &sub);
+				try {
+					f();
+				}
+				catch (...) {
+					TAPP = top;
+					throw;
+				}
+				TAPP = top;
+			});
+		}
+
+		namespace Subtest {
+			/**
+			 * The head of a `SUBTEST` block: assigning the block's body
+			 * runs it as a functional subtest, which catches a failed
+			 * `require` in it.
+			 */
+			struct Block {
+				bool planned = false;
+				unsigned int tests = 0;
+				std::string message;
+
+				Block(const std::string& message = "") : message(message) { }
+				Block(unsigned int tests, const std::string& message = "") :
+					planned(true), tests(tests), message(message) { }
+
+				bool operator=(std::function<void(void)> body) {
+					return planned ? subtest(tests, message, body) : subtest(message, body);
+				}
+			};
+		}
+
+		Context* thread_subtest(const std::string& message = "") { return TAPP->thread_subtest(message); }
+		void merge(void) { TAPP->merge(); }
+
+		/**
+		 * Syntactic sugar macro for a "SUBTEST" block. The block is the
+		 * body of a lambda, so it must be followed by a semicolon, and
+		 * a failed `require` only leaves the innermost block.
 		 */
 		#define SUBTEST(...)		\
-			if constexpr (auto TAPP_SUBTEST = subtest(__VA_ARGS__); true)
+			TAP::Subtest::Block(__VA_ARGS__) = [&] (void)
 
-		bool ok( bool is_ok,  const std::string& message = "") { return TAPP->ok( is_ok,  message); }
-		bool nok(bool is_nok, const std::string& message = "") { return TAPP->nok(is_nok, message); }
+		bool ok( bool is_ok,  std::string_view message = "") { return TAPP->ok( is_ok,  message); }
+		bool nok(bool is_nok, std::string_view message = "") { return TAPP->nok(is_nok, message); }
 
-		bool pass(const std::string& message = "") { return TAPP->pass(message); }
-		bool fail(const std::string& message = "") { return TAPP->fail(message); }
+		bool pass(std::string_view message = "") { return TAPP->pass(message); }
+		bool fail(std::string_view message = "") { return TAPP->fail(message); }
 
 		void TODO(const std::string& reason = "-") { TAPP->TODO(reason); }
+		void TODO(unsigned int how_many, const std::string& reason = "-") { TAPP->TODO(how_many, reason); }
 		void SKIP(const std::string& reason = "")  { TAPP->SKIP(reason); }
 		void SKIP(unsigned int how_many, const std::string& reason = "") { TAPP->SKIP(how_many, reason); }
 
 		void BAIL(const std::string& reason = "") { TAPP->BAIL(reason); }
 
+		void skip_rest(const std::string& reason = "") { TAPP->skip_rest(reason); }
+		bool require(bool is_ok, const std::string& message = "") { return TAPP->require(is_ok, message); }
+
+		template<typename T, typename U, typename Matcher = Equal>
+		bool require_is(const T& got, const U& expected, const std::string& message = "", Matcher m = Matcher()) {
+			return TAPP->require_is(got, expected, message, m);
+		}
+
+		template<typename... Ts>
+		void note(Ts&&... values) {
+			TAPP->note(std::forward<Ts>(values)...);
+		}
+
 		template<typename... Ts>
-		void diag(Ts... values) {
-			TAPP->diag(values...);
+		void diag(Ts&&... values) {
+			TAPP->diag(std::forward<Ts>(values)...);
 		}
 
-		template<typename T, typename U, typename Matcher = std::equal_to<T>>
-		bool is(const T& got, const U& expected, const std::string& message = "", Matcher m = Matcher()) {
+		void diagnostics(std::ostream* sink, bool flush = true) { TAPP->diagnostics(sink, flush); }
+
+		template<typename T, typename U, typename Matcher = Equal>
+		bool is(const T& got, const U& expected, std::string_view message = "", Matcher m = Matcher()) {
 			return TAPP->is(got, expected, message, m);
 		}
 
-		template<typename T, typename U, typename Matcher = std::equal_to<T>>
-		bool isnt(const T& got, const U& expected, const std::string& message = "", Matcher m = Matcher()) {
+		template<typename T, typename U, typename Matcher = Equal>
+		bool isnt(const T& got, const U& expected, std::string_view message = "", Matcher m = Matcher()) {
 			return TAPP->isnt(got, expected, message, m);
 		}
 
@@ -677,6 +5211,31 @@ namespace TAP {
 		bool throws_like(std::function<void(void)> f, const std::string& pattern, const std::string& message = "") {
 			return TAPP->throws_like<E>(f, pattern, message);
 		}
+
+		template<typename Rep, typename Period>
+		bool latency(const Bench::LoadReport& r, double q, std::chrono::duration<Rep, Period> limit, const std::string& message = "") {
+			return TAPP->latency(r, q, limit, message);
+		}
+
+		template<typename Ref, typename Impl, typename Gen, typename Matcher = Equal>
+		bool same_behavior(Ref ref, Impl impl, Gen gen, std::size_t n, const std::string& message = "", Matcher m = Matcher()) {
+			return TAPP->same_behavior(ref, impl, gen, n, message, m);
+		}
+
+		template<typename F>
+		bool deterministic(F f, unsigned int runs, const std::vector<unsigned int>& thread_counts, const std::string& message = "") {
+			return TAPP->deterministic(f, runs, thread_counts, message);
+		}
+
+		bool contains_any(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			return TAPP->contains_any(text, patterns, message);
+		}
+		bool contains_none(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			return TAPP->contains_none(text, patterns, message);
+		}
+		bool contains_all(std::string_view text, const Patterns& patterns, const std::string& message = "") {
+			return TAPP->contains_all(text, patterns, message);
+		}
 	}
 }
 